@@ -0,0 +1,82 @@
+#ifndef atomic_skip_map_node_h
+#define atomic_skip_map_node_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <utility>
+
+/**
+ * Base of the nodes of the skip maps used from many threads. Same layout as
+ * skip_map_node: the tower of links is placed in front of the node in the
+ * same allocation, but the links are std::atomic<Link>.
+ *
+ * Node derives from it and holds its own fields next to its entry. It stores
+ * its height in a std::uint8_t height_ member, is constructed from its height
+ * followed by the arguments of create(), and befriends this class.
+ */
+template <class Node, class Link>
+class atomic_skip_map_node {
+ public:
+  using link_type = std::atomic<Link>;
+
+  /**
+   * Allocates and constructs a node of the given height with value
+   * initialized links.
+   */
+  template <class... Args>
+  static Node* create(size_t height, Args&&... arguments) {
+    const size_t size = tower_size(height) + sizeof(Node);
+    auto base = static_cast<unsigned char*>(
+        ::operator new(size, std::align_val_t(alignment())));
+    Node* node;
+    try {
+      node = ::new (base + tower_size(height))
+          Node(height, std::forward<Args>(arguments)...);
+    } catch (...) {
+      ::operator delete(base, std::align_val_t(alignment()));
+      throw;
+    }
+    for (size_t i = 0; i < height; ++i) {
+      ::new (&node->link(i)) link_type(Link());
+    }
+    return node;
+  }
+
+  /**
+   * Destroys and frees a node obtained from create().
+   */
+  static void destroy(void* pointer) {
+    auto node = static_cast<Node*>(pointer);
+    auto base =
+        reinterpret_cast<unsigned char*>(node) - tower_size(node->height());
+    node->~Node();
+    ::operator delete(base, std::align_val_t(alignment()));
+  }
+
+  size_t height() const { return self()->height_; }
+
+  link_type& link(size_t i) const {
+    return *(reinterpret_cast<link_type*>(const_cast<unsigned char*>(
+                 reinterpret_cast<const unsigned char*>(self()))) -
+             1 - i);
+  }
+
+ protected:
+  atomic_skip_map_node() = default;
+
+ private:
+  static constexpr size_t alignment() {
+    return std::max(alignof(Node), alignof(link_type));
+  }
+
+  static constexpr size_t tower_size(size_t height) {
+    return (height * sizeof(link_type) + alignment() - 1) / alignment() *
+           alignment();
+  }
+
+  const Node* self() const { return static_cast<const Node*>(this); }
+};
+
+#endif /* atomic_skip_map_node_h */
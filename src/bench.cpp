@@ -1,11 +1,26 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <list>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
 #include "benchmark/benchmark.h"
+#include "concurrent_skip_map.h"
+#include "fixed_vector.hpp"
+#include "lazy_skip_map.h"
+#include "mapped_skip_map.h"
 #include "skip_map.h"
+#include "skip_map_arena_allocator.h"
 #include "test_facilities.hpp"
+#include "unrolled_skip_map.h"
+#include "versioned_skip_map.h"
 
-// TODO : Print structure to visualize problems, each level seems to be doing a
-// linear search this is like if all the level were full linked lists
 // TODO : Count allocations of objects through ctor calls
 // TODO : Different test using map of 10000 element already created
 
@@ -16,6 +31,36 @@ static void BM_SkipMapCreation(benchmark::State& state) {
   }
 }
 
+static void BM_IndexedSkipMapCreation(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    indexed_skip_map<Key, Value> sm;
+    fill(sm);
+  }
+}
+
+static void BM_SkipMapSortedCreation(benchmark::State& state) {
+  std::vector<KeyValue> data;
+  for (int i = 0; i < default_size; ++i) {
+    data.emplace_back(i, long_string);
+  }
+
+  while (state.KeepRunning()) {
+    skip_map<Key, Value> sm(sorted_unique, data.begin(), data.end());
+    benchmark::DoNotOptimize(sm);
+  }
+}
+
+// Many small maps, where the per map state and its setup weigh the most.
+static void BM_SkipMapSmallMaps(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    for (int i = 0; i < 1000; ++i) {
+      skip_map<Key, Value> sm;
+      fill(sm, 8);
+      benchmark::DoNotOptimize(sm);
+    }
+  }
+}
+
 static void BM_MapCreation(benchmark::State& state) {
   while (state.KeepRunning()) {
     std::map<Key, Value> m;
@@ -23,6 +68,656 @@ static void BM_MapCreation(benchmark::State& state) {
   }
 }
 
+// Keys 0 to size - 1 in order, or mostly sorted when jittered: every 8th
+// key is swapped with the one 3 places after, like slightly late timestamps.
+static std::vector<Key> hinted_keys(size_t size, bool jittered) {
+  std::vector<Key> keys(size);
+  std::iota(keys.begin(), keys.end(), 0);
+  if (jittered) {
+    for (size_t i = 0; i + 3 < size; i += 8) {
+      std::swap(keys[i], keys[i + 3]);
+    }
+  }
+  return keys;
+}
+
+// Inserts hinted at cend(), the position of every key but the late ones.
+static void BM_SkipMapEmplaceHint(benchmark::State& state) {
+  const auto keys = hinted_keys(default_size, state.range(0));
+  while (state.KeepRunning()) {
+    skip_map<Key, Value> sm;
+    for (Key key : keys) {
+      sm.emplace_hint(sm.cend(), key, long_string);
+    }
+  }
+}
+
+static void BM_MapEmplaceHint(benchmark::State& state) {
+  const auto keys = hinted_keys(default_size, state.range(0));
+  while (state.KeepRunning()) {
+    std::map<Key, Value> m;
+    for (Key key : keys) {
+      m.emplace_hint(m.cend(), key, long_string);
+    }
+  }
+}
+
+// Cost of skip_map::stats(), reporting the structure of the map as counters.
+static void BM_SkipMapStats(benchmark::State& state) {
+  skip_map<Key, Value> sm;
+  fill(sm, state.range(0));
+
+  skip_map_stats stats;
+  while (state.KeepRunning()) {
+    stats = sm.stats();
+    benchmark::DoNotOptimize(stats);
+  }
+
+  state.counters["max_level"] = stats.max_level;
+  state.counters["hops"] = std::accumulate(stats.average_hops.begin(),
+                                           stats.average_hops.end(), 0.);
+  state.counters["bytes_per_key"] =
+      static_cast<double>(stats.node_bytes) / stats.size;
+}
+
+// Erase and insert random keys in a map of default_size elements.
+template <typename Allocator>
+static void BM_SkipMapChurn(benchmark::State& state) {
+  skip_map<Key, Value, std::less<Key>, Allocator> sm;
+  fill(sm);
+
+  std::minstd_rand rand;
+  while (state.KeepRunning()) {
+    sm.erase(rand() % default_size);
+    sm.emplace(rand() % default_size, long_string);
+  }
+}
+
+constexpr int batch_map_size = 1000000;
+
+// Map of batch_map_size elements shared by the batch benchmarks.
+static const skip_map<Key, Value>& batch_map() {
+  static const skip_map<Key, Value> sm = [] {
+    std::vector<KeyValue> data;
+    for (int i = 0; i < batch_map_size; ++i) {
+      data.emplace_back(i, long_string);
+    }
+    return skip_map<Key, Value>(sorted_unique, data.begin(), data.end());
+  }();
+  return sm;
+}
+
+// Sorted random keys, a tenth of them missing from batch_map().
+static std::vector<Key> batch_keys(size_t count) {
+  std::minstd_rand rand;
+  std::vector<Key> keys(count);
+  for (auto& key : keys) {
+    key = rand() % (batch_map_size + batch_map_size / 10);
+  }
+  std::sort(keys.begin(), keys.end());
+  return keys;
+}
+
+// Look up state.range(0) sorted keys one find() at a time.
+static void BM_SkipMapFindEach(benchmark::State& state) {
+  const auto& sm = batch_map();
+  const auto keys = batch_keys(state.range(0));
+  while (state.KeepRunning()) {
+    for (auto key : keys) {
+      benchmark::DoNotOptimize(sm.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Same lookups with a single find_batch().
+static void BM_SkipMapFindBatch(benchmark::State& state) {
+  const auto& sm = batch_map();
+  const auto keys = batch_keys(state.range(0));
+  std::vector<skip_map<Key, Value>::const_iterator> found(keys.size());
+  while (state.KeepRunning()) {
+    sm.find_batch(keys.begin(), keys.end(), found.begin());
+    benchmark::DoNotOptimize(found.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Same lookups as BM_SkipMapFindEach in an unrolled_skip_map.
+static void BM_UnrolledSkipMapFindEach(benchmark::State& state) {
+  static const unrolled_skip_map<Key, Value> um = [] {
+    unrolled_skip_map<Key, Value> um;
+    for (int i = 0; i < batch_map_size; ++i) {
+      um.try_emplace(i, long_string);
+    }
+    return um;
+  }();
+  const auto keys = batch_keys(state.range(0));
+  while (state.KeepRunning()) {
+    for (auto key : keys) {
+      benchmark::DoNotOptimize(um.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Bytes requested from the allocator per element, for default_size * 100
+// elements inserted in random order.
+template <typename Map>
+static void BM_BytesPerKey(benchmark::State& state) {
+  constexpr int size = default_size * 100;
+  std::vector<int> keys(size);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::shuffle(keys.begin(), keys.end(), std::minstd_rand());
+
+  size_t bytes = 0;
+  while (state.KeepRunning()) {
+    const size_t before = allocation_counter::bytes;
+    Map map;
+    for (auto key : keys) {
+      map.insert({key, key});
+    }
+    bytes = allocation_counter::bytes - before;
+  }
+  state.counters["bytes_per_key"] = static_cast<double>(bytes) / size;
+}
+
+// Same order as std::less but opaque to the vector search, for the generic
+// search path.
+template <typename T>
+struct generic_less {
+  bool operator()(const T& lhs, const T& rhs) const { return lhs < rhs; }
+};
+
+// Random lookups in an unrolled_skip_map of default_size * 100 keys that fits
+// in the cache, so the search within blocks shows.
+template <typename Key, typename Compare, size_t BlockSize>
+static void BM_UnrolledKeySearch(benchmark::State& state) {
+  constexpr int size = default_size * 100;
+  using allocator = std::allocator<std::pair<const Key, int>>;
+  unrolled_skip_map<Key, int, Compare, allocator, BlockSize> um;
+  for (int i = 0; i < size; ++i) {
+    um.try_emplace(Key(i) * 3, i);
+  }
+
+  std::minstd_rand rand;
+  std::vector<Key> keys(4096);
+  for (auto& key : keys) {
+    key = Key(rand() % (size * 3));
+  }
+
+  while (state.KeepRunning()) {
+    for (auto key : keys) {
+      benchmark::DoNotOptimize(um.lower_bound(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Indexed map of state.range(0) elements, keys are 0, 2, 4...
+static const indexed_skip_map<int, int>& indexed_map(size_t size) {
+  static std::map<size_t, indexed_skip_map<int, int>> maps;
+  auto& sm = maps[size];
+  for (int i = sm.size(); i < static_cast<int>(size); ++i) {
+    sm.emplace_hint(sm.end(), i * 2, i);
+  }
+  return sm;
+}
+
+// Element at a random index by walking the list from begin().
+static void BM_SkipMapAdvance(benchmark::State& state) {
+  const auto& sm = indexed_map(state.range(0));
+  std::minstd_rand rand;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(std::next(sm.begin(), rand() % sm.size()));
+  }
+}
+
+// Element at a random index through the widths of the links.
+static void BM_IndexedSkipMapNth(benchmark::State& state) {
+  const auto& sm = indexed_map(state.range(0));
+  std::minstd_rand rand;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(sm.nth(rand() % sm.size()));
+  }
+}
+
+// Index of a random key by counting the elements before it.
+static void BM_SkipMapDistance(benchmark::State& state) {
+  const auto& sm = indexed_map(state.range(0));
+  std::minstd_rand rand;
+  while (state.KeepRunning()) {
+    int key = rand() % (sm.size() * 2);
+    benchmark::DoNotOptimize(std::distance(sm.begin(), sm.lower_bound(key)));
+  }
+}
+
+// Index of a random key summing widths during the search.
+static void BM_IndexedSkipMapRank(benchmark::State& state) {
+  const auto& sm = indexed_map(state.range(0));
+  std::minstd_rand rand;
+  while (state.KeepRunning()) {
+    int key = rand() % (sm.size() * 2);
+    benchmark::DoNotOptimize(sm.rank(key));
+  }
+}
+
+// The 10 last entries of a map of state.range(0) elements, by scanning the
+// whole map forward.
+static void BM_SkipMapLatestForward(benchmark::State& state) {
+  skip_map<int, int> sm;
+  for (int i = 0; i < state.range(0); ++i) {
+    sm.emplace_hint(sm.end(), i, i);
+  }
+
+  std::vector<int> latest(10);
+  while (state.KeepRunning()) {
+    size_t count = 0;
+    for (const auto& key_value : sm) {
+      latest[count++ % latest.size()] = key_value.first;
+    }
+    benchmark::DoNotOptimize(latest.data());
+  }
+}
+
+// The 10 last entries walking back from rbegin().
+static void BM_SkipMapLatestReverse(benchmark::State& state) {
+  bidirectional_skip_map<int, int> sm;
+  for (int i = 0; i < state.range(0); ++i) {
+    sm.emplace_hint(sm.end(), i, i);
+  }
+
+  std::vector<int> latest(10);
+  while (state.KeepRunning()) {
+    auto it = sm.rbegin();
+    for (auto& key : latest) {
+      key = (it++)->first;
+    }
+    benchmark::DoNotOptimize(latest.data());
+  }
+}
+
+// Consistent view of a map of state.range(0) elements by copying it.
+static void BM_SkipMapCopy(benchmark::State& state) {
+  skip_map<int, int> sm;
+  for (int i = 0; i < state.range(0); ++i) {
+    sm.emplace_hint(sm.end(), i, i);
+  }
+
+  int i = 0;
+  while (state.KeepRunning()) {
+    skip_map<int, int> copy(sm);
+    benchmark::DoNotOptimize(copy);
+    sm.insert_or_assign(i % state.range(0), i);
+    ++i;
+  }
+}
+
+// Consistent view through a snapshot, the overwritten value is kept until
+// the snapshot is dropped.
+static void BM_VersionedSkipMapSnapshot(benchmark::State& state) {
+  versioned_skip_map<int, int> vsm;
+  for (int i = 0; i < state.range(0); ++i) {
+    vsm.try_emplace(i, i);
+  }
+
+  int i = 0;
+  while (state.KeepRunning()) {
+    auto snapshot = vsm.snapshot();
+    benchmark::DoNotOptimize(snapshot);
+    vsm.insert_or_assign(i % state.range(0), i);
+    ++i;
+  }
+}
+
+constexpr int stored_map_size = 1000000;
+
+// Sorted pairs of a stored index of stored_map_size elements.
+static const std::vector<std::pair<int, int>>& stored_pairs() {
+  static const std::vector<std::pair<int, int>> pairs = [] {
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < stored_map_size; ++i) {
+      pairs.emplace_back(i * 2, i);
+    }
+    return pairs;
+  }();
+  return pairs;
+}
+
+// File of stored_pairs() written for mapped_skip_map.
+static const std::string& mapped_file() {
+  static const std::string path = [] {
+    const auto& pairs = stored_pairs();
+    std::string path =
+        std::filesystem::temp_directory_path() / "bench_mapped_skip_map";
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    mapped_skip_map<int, int>::write(
+        out, skip_map<int, int>(sorted_unique, pairs.begin(), pairs.end()));
+    return path;
+  }();
+  return path;
+}
+
+// Restart by inserting every stored pair back, then a first lookup.
+static void BM_SkipMapReload(benchmark::State& state) {
+  const auto& pairs = stored_pairs();
+  while (state.KeepRunning()) {
+    skip_map<int, int> sm;
+    for (const auto& pair : pairs) {
+      sm.insert(pair);
+    }
+    benchmark::DoNotOptimize(sm.find(stored_map_size));
+  }
+  state.SetItemsProcessed(state.iterations() * pairs.size());
+  state.SetBytesProcessed(state.iterations() * pairs.size() *
+                          sizeof(pairs[0]));
+}
+
+// Restart by mapping the stored file, then a first lookup.
+static void BM_MappedSkipMapOpen(benchmark::State& state) {
+  const auto& path = mapped_file();
+  while (state.KeepRunning()) {
+    mapped_skip_map<int, int> mapped(path);
+    benchmark::DoNotOptimize(mapped.find(stored_map_size));
+  }
+}
+
+// Stream of stored_pairs() written by skip_map::save() with KeyCodec.
+template <typename KeyCodec>
+static std::string saved_stream() {
+  const auto& pairs = stored_pairs();
+  std::ostringstream out;
+  skip_map<int, int>(sorted_unique, pairs.begin(), pairs.end())
+      .save(out, KeyCodec());
+  return out.str();
+}
+
+static void BM_SkipMapSave(benchmark::State& state) {
+  const auto& pairs = stored_pairs();
+  skip_map<int, int> sm(sorted_unique, pairs.begin(), pairs.end());
+  std::ostringstream out;
+  while (state.KeepRunning()) {
+    out.str("");
+    sm.save(out);
+  }
+  state.SetItemsProcessed(state.iterations() * sm.size());
+  state.SetBytesProcessed(state.iterations() * out.str().size());
+}
+
+// Restart by loading a saved stream, next to BM_SkipMapReload. Bytes are the
+// ones of the stream.
+template <typename KeyCodec>
+static void BM_SkipMapLoad(benchmark::State& state) {
+  std::istringstream in(saved_stream<KeyCodec>());
+  const size_t bytes = in.str().size();
+  while (state.KeepRunning()) {
+    in.clear();
+    in.seekg(0);
+    skip_map<int, int> sm;
+    sm.load(in, KeyCodec());
+    benchmark::DoNotOptimize(sm.find(stored_map_size));
+  }
+  state.SetItemsProcessed(state.iterations() * stored_map_size);
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+// Same from a file, read one block at a time.
+static void BM_SkipMapLoadFile(benchmark::State& state) {
+  const std::string path =
+      std::filesystem::temp_directory_path() / "bench_saved_skip_map";
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << saved_stream<skip_map_codec<int>>();
+  }
+  while (state.KeepRunning()) {
+    std::ifstream in(path, std::ios::binary);
+    skip_map<int, int> sm;
+    sm.load(in);
+    benchmark::DoNotOptimize(sm.find(stored_map_size));
+  }
+  state.SetItemsProcessed(state.iterations() * stored_map_size);
+  state.SetBytesProcessed(state.iterations() *
+                          std::filesystem::file_size(path));
+}
+
+// Random lookups once the index is loaded.
+static void BM_SkipMapFindStored(benchmark::State& state) {
+  const auto& pairs = stored_pairs();
+  skip_map<int, int> sm(sorted_unique, pairs.begin(), pairs.end());
+  std::minstd_rand rand;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(sm.find(rand() % (stored_map_size * 2)));
+  }
+}
+
+// Same lookups in the mapped file.
+static void BM_MappedSkipMapFind(benchmark::State& state) {
+  mapped_skip_map<int, int> mapped(mapped_file());
+  std::minstd_rand rand;
+  while (state.KeepRunning()) {
+    benchmark::DoNotOptimize(mapped.find(rand() % (stored_map_size * 2)));
+  }
+}
+
+constexpr int large_map_size = 10000000;
+
+// Map of large_map_size elements, far larger than the last level cache.
+static const skip_map<int, int>& large_map() {
+  static const skip_map<int, int> sm = [] {
+    std::vector<std::pair<int, int>> data;
+    data.reserve(large_map_size);
+    for (int i = 0; i < large_map_size; ++i) {
+      data.emplace_back(i, i);
+    }
+    return skip_map<int, int>(sorted_unique, data.begin(), data.end());
+  }();
+  return sm;
+}
+
+// Unsorted random keys of large_map().
+static std::vector<int> large_map_keys() {
+  std::minstd_rand rand;
+  std::vector<int> keys(4096);
+  for (auto& key : keys) {
+    key = rand() % large_map_size;
+  }
+  return keys;
+}
+
+// Random lookups in large_map() one find() at a time.
+static void BM_SkipMapFindLarge(benchmark::State& state) {
+  const auto& sm = large_map();
+  const auto keys = large_map_keys();
+  while (state.KeepRunning()) {
+    for (auto key : keys) {
+      benchmark::DoNotOptimize(sm.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Same lookups with Lanes searches interleaved.
+template <size_t Lanes>
+static void BM_SkipMapFindInterleavedLarge(benchmark::State& state) {
+  const auto& sm = large_map();
+  const auto keys = large_map_keys();
+  std::vector<skip_map<int, int>::const_iterator> found(keys.size());
+  while (state.KeepRunning()) {
+    sm.find_interleaved<Lanes>(keys.begin(), keys.end(), found.begin());
+    benchmark::DoNotOptimize(found.data());
+  }
+  state.SetItemsProcessed(state.iterations() * keys.size());
+}
+
+// Keys of the shared map in the read/write mix benchmarks, half of them are
+// present at the start.
+constexpr uint32_t mix_key_range = 1 << 16;
+
+static uint32_t xorshift(uint32_t& state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// Every thread runs one insert and one erase for 14 lookups on random keys
+// of a map shared by all the threads.
+static void BM_ConcurrentSkipMapMix(benchmark::State& state) {
+  static concurrent_skip_map<int, int>* csm;
+  if (state.thread_index() == 0) {
+    csm = new concurrent_skip_map<int, int>;
+    for (uint32_t i = 0; i < mix_key_range; i += 2) {
+      csm->try_emplace(i, i);
+    }
+  }
+
+  uint32_t seed = state.thread_index() + 1;
+  while (state.KeepRunning()) {
+    uint32_t random = xorshift(seed);
+    int key = random % mix_key_range;
+    switch (random >> 28) {
+      case 0:
+        benchmark::DoNotOptimize(csm->try_emplace(key, key));
+        break;
+      case 1:
+        benchmark::DoNotOptimize(csm->erase(key));
+        break;
+      default:
+        benchmark::DoNotOptimize(csm->find(key));
+    }
+  }
+
+  if (state.thread_index() == 0) {
+    delete csm;
+  }
+}
+
+// Same mix on a skip_map behind a single mutex.
+static void BM_LockedSkipMapMix(benchmark::State& state) {
+  static skip_map<int, int>* sm;
+  static std::mutex mutex;
+  if (state.thread_index() == 0) {
+    sm = new skip_map<int, int>;
+    for (uint32_t i = 0; i < mix_key_range; i += 2) {
+      sm->try_emplace(i, i);
+    }
+  }
+
+  uint32_t seed = state.thread_index() + 1;
+  while (state.KeepRunning()) {
+    uint32_t random = xorshift(seed);
+    int key = random % mix_key_range;
+    std::lock_guard<std::mutex> lock(mutex);
+    switch (random >> 28) {
+      case 0:
+        benchmark::DoNotOptimize(sm->try_emplace(key, key));
+        break;
+      case 1:
+        benchmark::DoNotOptimize(sm->erase(key));
+        break;
+      default:
+        benchmark::DoNotOptimize(sm->find(key));
+    }
+  }
+
+  if (state.thread_index() == 0) {
+    delete sm;
+  }
+}
+
+// Draws keys of [0, n) with a zipfian distribution of exponent theta. Ranks
+// are scattered over the key space so the hot keys are not all neighbours, n
+// has to be a power of two.
+class zipfian_keys {
+ public:
+  zipfian_keys(uint32_t n, double theta) : cdf_(n) {
+    double sum = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      sum += 1 / std::pow(i + 1, theta);
+      cdf_[i] = sum;
+    }
+    for (auto& c : cdf_) {
+      c /= sum;
+    }
+  }
+
+  int operator()(uint32_t& seed) const {
+    double u = xorshift(seed) / 4294967296.0;
+    auto rank = std::lower_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin();
+    return (rank * 2654435761u) & (cdf_.size() - 1);
+  }
+
+ private:
+  std::vector<double> cdf_;
+};
+
+static const zipfian_keys& zipfian() {
+  static const zipfian_keys keys(mix_key_range, 0.99);
+  return keys;
+}
+
+// 95% lookups and 5% writes on zipfian keys of a map shared by all the
+// threads, most operations go to a few hot keys.
+template <typename Map>
+static void BM_ZipfianMix(benchmark::State& state) {
+  static Map* map;
+  if (state.thread_index() == 0) {
+    map = new Map;
+    for (uint32_t i = 0; i < mix_key_range; i += 2) {
+      map->try_emplace(i, i);
+    }
+  }
+
+  uint32_t seed = state.thread_index() + 1;
+  while (state.KeepRunning()) {
+    int key = zipfian()(seed);
+    uint32_t operation = xorshift(seed) % 100;
+    if (operation < 95) {
+      benchmark::DoNotOptimize(map->find(key));
+    } else if (operation < 98) {
+      benchmark::DoNotOptimize(map->try_emplace(key, key));
+    } else {
+      benchmark::DoNotOptimize(map->erase(key));
+    }
+  }
+
+  if (state.thread_index() == 0) {
+    delete map;
+  }
+}
+
+// Same mix on a skip_map behind a single mutex.
+static void BM_LockedZipfianMix(benchmark::State& state) {
+  static skip_map<int, int>* sm;
+  static std::mutex mutex;
+  if (state.thread_index() == 0) {
+    sm = new skip_map<int, int>;
+    for (uint32_t i = 0; i < mix_key_range; i += 2) {
+      sm->try_emplace(i, i);
+    }
+  }
+
+  uint32_t seed = state.thread_index() + 1;
+  while (state.KeepRunning()) {
+    int key = zipfian()(seed);
+    uint32_t operation = xorshift(seed) % 100;
+    std::lock_guard<std::mutex> lock(mutex);
+    if (operation < 95) {
+      benchmark::DoNotOptimize(sm->find(key));
+    } else if (operation < 98) {
+      benchmark::DoNotOptimize(sm->try_emplace(key, key));
+    } else {
+      benchmark::DoNotOptimize(sm->erase(key));
+    }
+  }
+
+  if (state.thread_index() == 0) {
+    delete sm;
+  }
+}
+
+static const int max_threads =
+    std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
 static void BM_FixedVectorCreation(benchmark::State& state) {
   while (state.KeepRunning()) {
     fixed_vector<int, MAX_LEVEL> f;
@@ -43,19 +738,27 @@ static void BM_VectorCreation(benchmark::State& state) {
   }
 }
 
+// skip_map looking like a linked-list.
+using flat_skip_map = skip_map<Key,
+                               Value,
+                               std::less<Key>,
+                               std::allocator<skip_map_node<Key, Value>>,
+                               16,
+                               std::ratio<1, 4>,
+                               flat_levels>;
+
 class MyFixture : public benchmark::Fixture {
  public:
   void SetUp(const ::benchmark::State& /*state*/) {
-    // Fill a skip_map making sure that it looks like a linked-list as much as
-    // possible.
-    sm.set_gen_for_testing([]() { return 0; });
     fill(sm);
+    fill(um);
 
     // Fill an equivalent linked-list.
     l = std::list<KeyValue>(default_size, {1, long_string});
   }
 
-  skip_map<Key, Value> sm;
+  flat_skip_map sm;
+  unrolled_skip_map<Key, Value> um;
   std::list<KeyValue> l;
 };
 
@@ -73,8 +776,82 @@ BENCHMARK_F(MyFixture, BM_SkipMapIterate)(benchmark::State& state) {
   }
 }
 
+BENCHMARK_F(MyFixture, BM_UnrolledSkipMapIterate)(benchmark::State& state) {
+  while (state.KeepRunning()) {
+    for (auto it = um.cbegin(); it != um.cend(); ++it)
+      ;
+  }
+}
+
 BENCHMARK(BM_SkipMapCreation);
+BENCHMARK(BM_IndexedSkipMapCreation);
+BENCHMARK(BM_SkipMapSortedCreation);
+BENCHMARK(BM_SkipMapSmallMaps);
 BENCHMARK(BM_MapCreation);
+BENCHMARK(BM_SkipMapEmplaceHint)->Arg(0)->Arg(1);
+BENCHMARK(BM_MapEmplaceHint)->Arg(0)->Arg(1);
+BENCHMARK(BM_SkipMapStats)->Arg(1000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_SkipMapChurn, std::allocator<KeyValue>);
+BENCHMARK_TEMPLATE(BM_SkipMapChurn, skip_map_arena_allocator<KeyValue>);
+BENCHMARK(BM_SkipMapFindEach)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_SkipMapFindBatch)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK(BM_UnrolledSkipMapFindEach)->Arg(1000)->Arg(10000)->Arg(100000);
+BENCHMARK_TEMPLATE(BM_BytesPerKey,
+                   skip_map<int, int, std::less<int>,
+                            counting_allocator<std::pair<const int, int>>>);
+BENCHMARK_TEMPLATE(
+    BM_BytesPerKey,
+    bidirectional_skip_map<int, int, std::less<int>,
+                           counting_allocator<std::pair<const int, int>>>);
+BENCHMARK_TEMPLATE(
+    BM_BytesPerKey,
+    unrolled_skip_map<int, int, std::less<int>,
+                      counting_allocator<std::pair<const int, int>>>);
+BENCHMARK_TEMPLATE(BM_BytesPerKey,
+                   std::map<int, int, std::less<int>,
+                            counting_allocator<std::pair<const int, int>>>);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int32_t, std::less<int32_t>, 16);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int32_t, generic_less<int32_t>, 16);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int32_t, std::less<int32_t>, 64);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int32_t, generic_less<int32_t>, 64);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int64_t, std::less<int64_t>, 16);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int64_t, generic_less<int64_t>, 16);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int64_t, std::less<int64_t>, 64);
+BENCHMARK_TEMPLATE(BM_UnrolledKeySearch, int64_t, generic_less<int64_t>, 64);
+BENCHMARK(BM_SkipMapAdvance)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_IndexedSkipMapNth)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_SkipMapDistance)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_IndexedSkipMapRank)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_SkipMapLatestForward)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_SkipMapLatestReverse)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_SkipMapCopy)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_VersionedSkipMapSnapshot)->Arg(1000)->Arg(100000);
+BENCHMARK(BM_SkipMapReload)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MappedSkipMapOpen);
+BENCHMARK(BM_SkipMapSave)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SkipMapLoad, skip_map_codec<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_SkipMapLoad, skip_map_delta_codec<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SkipMapLoadFile)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_SkipMapFindStored);
+BENCHMARK(BM_MappedSkipMapFind);
+BENCHMARK(BM_SkipMapFindLarge);
+BENCHMARK_TEMPLATE(BM_SkipMapFindInterleavedLarge, 1);
+BENCHMARK_TEMPLATE(BM_SkipMapFindInterleavedLarge, 8);
+BENCHMARK_TEMPLATE(BM_SkipMapFindInterleavedLarge, 16);
+BENCHMARK(BM_ConcurrentSkipMapMix)->ThreadRange(1, max_threads)->UseRealTime();
+BENCHMARK(BM_LockedSkipMapMix)->ThreadRange(1, max_threads)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ZipfianMix, lazy_skip_map<int, int>)
+    ->ThreadRange(1, max_threads)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ZipfianMix, concurrent_skip_map<int, int>)
+    ->ThreadRange(1, max_threads)
+    ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_ZipfianMix, versioned_skip_map<int, int>)
+    ->ThreadRange(1, max_threads)
+    ->UseRealTime();
+BENCHMARK(BM_LockedZipfianMix)->ThreadRange(1, max_threads)->UseRealTime();
 
 BENCHMARK(BM_FixedVectorCreation);
 BENCHMARK(BM_VectorCreation);
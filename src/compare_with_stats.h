@@ -0,0 +1,23 @@
+#ifndef compare_with_stats_h
+#define compare_with_stats_h
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * Comparator counting its calls, to pass as Compare when a container has to
+ * be instrumented. The count is a mutable member of the container's copy of
+ * the comparator: it costs a store on every comparison and makes concurrent
+ * lookups race, it is meant for tests and measurements only.
+ */
+template <typename T>
+struct compare_with_stats {
+  constexpr bool operator()(const T& lhs, const T& rhs) const {
+    ++compare_count;
+    return std::less<T>()(lhs, rhs);
+  }
+
+  mutable size_t compare_count{0};
+};
+
+#endif /* compare_with_stats_h */
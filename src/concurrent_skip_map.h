@@ -0,0 +1,375 @@
+#ifndef concurrent_skip_map_h
+#define concurrent_skip_map_h
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <ratio>
+#include <tuple>
+#include <utility>
+#include "atomic_skip_map_node.h"
+#include "epoch_domain.h"
+#include "level_generator.h"
+
+/**
+ * Node of a concurrent_skip_map. The lowest bit of its atomic links marks the
+ * node as logically removed on that level.
+ */
+template <class Key, class T>
+class concurrent_skip_map_node
+    : public atomic_skip_map_node<concurrent_skip_map_node<Key, T>,
+                                  std::uintptr_t> {
+ public:
+  static concurrent_skip_map_node* pointer(std::uintptr_t link) {
+    return reinterpret_cast<concurrent_skip_map_node*>(link & ~uintptr_t(1));
+  }
+
+  static bool marked(std::uintptr_t link) { return link & 1; }
+
+  static std::uintptr_t unmarked(const concurrent_skip_map_node* node) {
+    return reinterpret_cast<std::uintptr_t>(node);
+  }
+
+  std::pair<const Key, T> entry;
+
+  /**
+   * The inserting thread and the removing thread each hold a reference. The
+   * last one to be done with the node retires it, this way a node is never
+   * retired while an insertion is still linking its upper levels.
+   */
+  std::atomic<std::uint8_t> references{2};
+
+ private:
+  friend class atomic_skip_map_node<concurrent_skip_map_node, std::uintptr_t>;
+
+  template <class... Args>
+  explicit concurrent_skip_map_node(size_t height, Args&&... arguments)
+      : entry(std::forward<Args>(arguments)...),
+        height_(static_cast<std::uint8_t>(height)) {}
+
+  std::uint8_t height_;
+};
+
+/**
+ * concurrent_skip_map is a sorted associative container with unique keys that
+ * can be used from many threads at the same time without locks. It is the
+ * lock-free skip list of Herlihy and Shavit:
+ *
+ * - Lookups only follow links and never write to shared memory.
+ * - Insertions link a node on level 0 with a CAS, which is the point where the
+ *   element becomes visible, then link the upper levels one by one.
+ * - Erasures mark the links of a node from the top down, marking level 0
+ *   removes the element. Marked nodes are unlinked by the next search going
+ *   through them.
+ *
+ * Unlinked nodes are freed through epoch_domain once no operation can still
+ * be reading them. Mapped values are not modified once inserted and lookups
+ * return copies.
+ */
+template <class Key,
+          class T,
+          class Compare = std::less<Key>,
+          size_t MaxLevel = 16,
+          class Probability = std::ratio<1, 4>>
+class concurrent_skip_map {
+ public:
+  static_assert(MaxLevel > 0 && MaxLevel <= 255,
+                "Node heights are stored on a single byte");
+
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using size_type = std::size_t;
+  using key_compare = Compare;
+  using node_type = concurrent_skip_map_node<Key, T>;
+
+  concurrent_skip_map() : head_(node_type::create(MaxLevel)) {}
+
+  concurrent_skip_map(const concurrent_skip_map&) = delete;
+  concurrent_skip_map& operator=(const concurrent_skip_map&) = delete;
+
+  /**
+   * No other thread may be using the container anymore. Nodes that were
+   * already unlinked are owned by the epoch domain.
+   */
+  ~concurrent_skip_map() {
+    for (auto node = head_; node;) {
+      auto next = node_type::pointer(node->link(0).load());
+      node_type::destroy(node);
+      node = next;
+    }
+  }
+
+  /**
+   * Inserts value if there is no element with an equivalent key. Returns
+   * whether the insertion took place.
+   */
+  bool insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  /**
+   * If there is no element with a key equivalent to key, inserts an element
+   * with the key and a mapped value constructed from args. Returns whether the
+   * insertion took place.
+   */
+  template <class... Args>
+  bool try_emplace(const key_type& key, Args&&... args) {
+    epoch_domain::guard guard;
+
+    level_nodes_t preds;
+    level_nodes_t succs;
+    node_type* new_node = nullptr;
+    const size_t height = thread_level<MaxLevel, Probability>() + 1;
+
+    // Link on level 0, after which the element is in the container.
+    for (;;) {
+      if (find_splice(key, preds, succs)) {
+        if (new_node) {
+          node_type::destroy(new_node);
+        }
+        return false;
+      }
+
+      if (!new_node) {
+        new_node = node_type::create(
+            height, std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+      }
+      for (size_t i = 0; i < height; ++i) {
+        new_node->link(i).store(node_type::unmarked(succs[i]),
+                                std::memory_order_relaxed);
+      }
+
+      auto expected = node_type::unmarked(succs[0]);
+      if (preds[0]->link(0).compare_exchange_strong(
+              expected, node_type::unmarked(new_node))) {
+        break;
+      }
+    }
+    size_.fetch_add(1, std::memory_order_relaxed);
+
+    // Link the upper levels unless the node gets removed in the meantime.
+    bool removed = false;
+    for (size_t level = 1; level < height && !removed; ++level) {
+      for (;;) {
+        auto next = new_node->link(level).load();
+        if (node_type::marked(next)) {
+          removed = true;
+          break;
+        }
+
+        // The successor changed since the node was created.
+        auto succ = node_type::unmarked(succs[level]);
+        if (next != succ &&
+            !new_node->link(level).compare_exchange_strong(next, succ)) {
+          continue;
+        }
+
+        auto expected = succ;
+        if (preds[level]->link(level).compare_exchange_strong(
+                expected, node_type::unmarked(new_node))) {
+          break;
+        }
+
+        find_splice(key, preds, succs);
+        if (succs[0] != new_node) {
+          removed = true;
+          break;
+        }
+      }
+    }
+
+    // An erasure might have run before some levels were linked, make sure
+    // none of them stays reachable.
+    if (node_type::marked(new_node->link(0).load())) {
+      find_splice(key, preds, succs);
+    }
+    release(new_node);
+
+    return true;
+  }
+
+  /**
+   * Removes the element with a key equivalent to key. Returns whether this
+   * call removed it.
+   */
+  bool erase(const key_type& key) {
+    epoch_domain::guard guard;
+
+    level_nodes_t preds;
+    level_nodes_t succs;
+    if (!find_splice(key, preds, succs)) {
+      return false;
+    }
+
+    // Mark the upper levels first so the insertion stops linking new ones.
+    node_type* node = succs[0];
+    for (size_t level = node->height(); level-- > 1;) {
+      auto next = node->link(level).load();
+      while (!node_type::marked(next) &&
+             !node->link(level).compare_exchange_weak(next, next | 1)) {
+      }
+    }
+
+    // Whoever marks level 0 removed the element.
+    auto next = node->link(0).load();
+    do {
+      if (node_type::marked(next)) {
+        return false;
+      }
+    } while (!node->link(0).compare_exchange_weak(next, next | 1));
+    size_.fetch_sub(1, std::memory_order_relaxed);
+
+    // Unlink the node from every level.
+    find_splice(key, preds, succs);
+    release(node);
+
+    return true;
+  }
+
+  /**
+   * Checks if there is an element with a key equivalent to key.
+   */
+  bool contains(const key_type& key) const {
+    epoch_domain::guard guard;
+    auto node = search(key);
+    return node && !key_comparator_(key, node->entry.first);
+  }
+
+  /**
+   * Returns a copy of the mapped value of the element with a key equivalent
+   * to key, if any.
+   */
+  std::optional<T> find(const key_type& key) const {
+    epoch_domain::guard guard;
+    auto node = search(key);
+    if (node && !key_comparator_(key, node->entry.first)) {
+      return node->entry.second;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Returns a copy of the first element that is not less than key, if any.
+   */
+  std::optional<value_type> lower_bound(const key_type& key) const {
+    epoch_domain::guard guard;
+    if (auto node = search(key)) {
+      return node->entry;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Calls f on every element in order. Elements inserted or erased during the
+   * walk may or may not be seen.
+   */
+  template <class F>
+  void for_each(F&& f) const {
+    epoch_domain::guard guard;
+    for (auto node = next_at(head_, 0); node; node = next_at(node, 0)) {
+      f(static_cast<const value_type&>(node->entry));
+    }
+  }
+
+  /**
+   * Number of elements. Exact only when no modification is in progress.
+   */
+  size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  using level_nodes_t = std::array<node_type*, MaxLevel>;
+
+  /**
+   * Fills preds and succs with the last node before key and the first node
+   * not before it on every level. Marked nodes met on the way are unlinked,
+   * the search starts over if that fails. Returns whether succs[0] holds key.
+   */
+  bool find_splice(const Key& key, level_nodes_t& preds, level_nodes_t& succs) {
+    while (!try_find_splice(key, preds, succs)) {
+    }
+    return succs[0] && !key_comparator_(key, succs[0]->entry.first);
+  }
+
+  bool try_find_splice(const Key& key,
+                       level_nodes_t& preds,
+                       level_nodes_t& succs) {
+    node_type* pred = head_;
+    for (size_t level = MaxLevel; level-- > 0;) {
+      auto curr = node_type::pointer(pred->link(level).load());
+      while (curr) {
+        auto succ = curr->link(level).load();
+        if (node_type::marked(succ)) {
+          auto expected = node_type::unmarked(curr);
+          if (!pred->link(level).compare_exchange_strong(
+                  expected, node_type::unmarked(node_type::pointer(succ)))) {
+            return false;
+          }
+          curr = node_type::pointer(succ);
+          continue;
+        }
+
+        if (!key_comparator_(curr->entry.first, key)) {
+          break;
+        }
+        pred = curr;
+        curr = node_type::pointer(succ);
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return true;
+  }
+
+  /**
+   * Returns the first node not before key that was not removed, without
+   * writing anything.
+   */
+  node_type* search(const Key& key) const {
+    node_type* pred = head_;
+    node_type* curr = nullptr;
+    for (size_t level = MaxLevel; level-- > 0;) {
+      curr = next_at(pred, level);
+      while (curr && key_comparator_(curr->entry.first, key)) {
+        pred = curr;
+        curr = next_at(curr, level);
+      }
+    }
+    return curr;
+  }
+
+  /**
+   * Returns the node following node on level, skipping removed ones.
+   */
+  static node_type* next_at(const node_type* node, size_t level) {
+    auto curr = node_type::pointer(node->link(level).load());
+    while (curr) {
+      auto succ = curr->link(level).load();
+      if (!node_type::marked(succ)) {
+        break;
+      }
+      curr = node_type::pointer(succ);
+    }
+    return curr;
+  }
+
+  void release(node_type* node) {
+    if (node->references.fetch_sub(1) == 1) {
+      epoch_domain::instance().retire(node, &node_type::destroy);
+    }
+  }
+
+  node_type* head_;
+  std::atomic<size_type> size_{0};
+  key_compare key_comparator_;
+};
+
+#endif /* concurrent_skip_map_h */
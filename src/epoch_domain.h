@@ -0,0 +1,239 @@
+#ifndef epoch_domain_h
+#define epoch_domain_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Epoch based reclamation shared by all the containers of the process. Threads
+ * pin the current epoch for the duration of an operation and objects unlinked
+ * from a structure are retired instead of being freed. An object retired
+ * during epoch e is only freed once the global epoch reached e + 2, at which
+ * point no thread can still be in an operation that started before it was
+ * unlinked.
+ *
+ * Readers only pay for pinning and unpinning. The cost of reclamation is
+ * amortized over the retiring threads: every collect_threshold retirements a
+ * thread tries to move the epoch forward and frees what expired. As long as
+ * threads keep unpinning, each thread holds at most a few batches.
+ */
+class epoch_domain {
+  struct participant;
+
+ public:
+  using deleter_type = void (*)(void*);
+
+  /**
+   * Number of retirements after which a thread frees what it can.
+   */
+  static constexpr size_t collect_threshold = 64;
+
+  /**
+   * The domain used by every container.
+   */
+  static epoch_domain& instance() {
+    static epoch_domain domain;
+    return domain;
+  }
+
+  /**
+   * Pins the current epoch for the calling thread during its lifetime. Guards
+   * can be nested.
+   */
+  class guard {
+   public:
+    guard() : participant_(instance().local()) { instance().pin(participant_); }
+    ~guard() { instance().unpin(participant_); }
+
+    guard(const guard&) = delete;
+    guard& operator=(const guard&) = delete;
+
+   private:
+    participant& participant_;
+  };
+
+  /**
+   * Hands object over to be freed with deleter once no thread can access it
+   * anymore. object has to be unreachable from the structure already.
+   */
+  void retire(void* object, deleter_type deleter) {
+    auto& self = local();
+    self.retired.push_back({object, deleter, epoch_.load()});
+    if (self.retired.size() % collect_threshold == 0) {
+      collect(self);
+    }
+  }
+
+  /**
+   * Frees the objects retired by the calling thread that expired.
+   */
+  void collect() { collect(local()); }
+
+  /**
+   * Waits until every object retired by the calling thread so far is freed.
+   * The calling thread must not be pinned.
+   */
+  void synchronize() {
+    auto& self = local();
+    while (!self.retired.empty()) {
+      collect(self);
+      if (!self.retired.empty()) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  /**
+   * Number of objects retired by the calling thread not freed yet.
+   */
+  size_t pending() { return local().retired.size(); }
+
+  uint64_t epoch() const { return epoch_.load(); }
+
+  ~epoch_domain() {
+    for (auto p = participants_.load(); p;) {
+      auto next = p->next;
+      free_all(p->retired);
+      delete p;
+      p = next;
+    }
+    free_all(orphans_);
+  }
+
+ private:
+  struct retired_object {
+    void* object;
+    deleter_type deleter;
+    uint64_t epoch;
+  };
+
+  epoch_domain() = default;
+
+  /**
+   * Per thread state. The state holds the pinned epoch shifted by one with
+   * the lowest bit telling if the thread is pinned.
+   */
+  struct participant {
+    std::atomic<uint64_t> state{0};
+    std::atomic<bool> owned{true};
+    participant* next{nullptr};
+
+    // Only accessed by the owning thread.
+    size_t depth{0};
+    std::vector<retired_object> retired;
+  };
+
+  /**
+   * Registers the thread on first use and gives back its participant when
+   * the thread exits.
+   */
+  struct registration {
+    explicit registration(epoch_domain& domain)
+        : domain_(domain), participant_(domain.acquire()) {}
+    ~registration() { domain_.release(participant_); }
+
+    epoch_domain& domain_;
+    participant& participant_;
+  };
+
+  participant& local() {
+    thread_local registration reg(*this);
+    return reg.participant_;
+  }
+
+  participant& acquire() {
+    // Reuse the participant of a thread that exited.
+    for (auto p = participants_.load(); p; p = p->next) {
+      bool owned = false;
+      if (!p->owned.load() && p->owned.compare_exchange_strong(owned, true)) {
+        return *p;
+      }
+    }
+
+    auto p = new participant;
+    p->next = participants_.load();
+    while (!participants_.compare_exchange_weak(p->next, p)) {
+    }
+    return *p;
+  }
+
+  /**
+   * What the exiting thread did not free yet is adopted by the next thread
+   * collecting.
+   */
+  void release(participant& p) {
+    {
+      std::lock_guard<std::mutex> lock(orphans_mutex_);
+      orphans_.insert(orphans_.end(), p.retired.begin(), p.retired.end());
+    }
+    p.retired.clear();
+    p.retired.shrink_to_fit();
+    p.state.store(0);
+    p.owned.store(false);
+  }
+
+  void pin(participant& p) {
+    if (p.depth++ == 0) {
+      p.state.store((epoch_.load() << 1) | 1);
+    }
+  }
+
+  void unpin(participant& p) {
+    if (--p.depth == 0) {
+      p.state.store(0, std::memory_order_release);
+    }
+  }
+
+  /**
+   * Moves the global epoch forward if every pinned thread is on it.
+   */
+  void try_advance() {
+    uint64_t epoch = epoch_.load();
+    for (auto p = participants_.load(); p; p = p->next) {
+      uint64_t state = p->state.load();
+      if ((state & 1) && (state >> 1) != epoch) {
+        return;
+      }
+    }
+    epoch_.compare_exchange_strong(epoch, epoch + 1);
+  }
+
+  void collect(participant& p) {
+    try_advance();
+    free_expired(p.retired);
+
+    std::unique_lock<std::mutex> lock(orphans_mutex_, std::try_to_lock);
+    if (lock.owns_lock()) {
+      free_expired(orphans_);
+    }
+  }
+
+  void free_expired(std::vector<retired_object>& objects) {
+    const uint64_t epoch = epoch_.load();
+    auto expired = std::partition(
+        objects.begin(), objects.end(),
+        [epoch](const retired_object& r) { return r.epoch + 2 > epoch; });
+    std::for_each(expired, objects.end(),
+                  [](const retired_object& r) { r.deleter(r.object); });
+    objects.erase(expired, objects.end());
+  }
+
+  static void free_all(std::vector<retired_object>& objects) {
+    for (const auto& r : objects) {
+      r.deleter(r.object);
+    }
+    objects.clear();
+  }
+
+  std::atomic<uint64_t> epoch_{0};
+  std::atomic<participant*> participants_{nullptr};
+
+  std::mutex orphans_mutex_;
+  std::vector<retired_object> orphans_;
+};
+
+#endif /* epoch_domain_h */
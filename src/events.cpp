@@ -5,16 +5,29 @@
 // See misses difference  : sudo perf record -e LLC-misses -c 10 -g -- ./events
 
 // Analyze using : sudo perf report --symbol-filter=iterate
+//                 sudo perf report --symbol-filter=find
 
 #include <iostream>
 #include <list>
+#include <random>
+#include <vector>
 #include "benchmark/benchmark.h"
 #include "skip_map.h"
 #include "test_facilities.hpp"
 
 size_t large_size = 10000;
+int lookup_map_size = 10000000;
 
-void __attribute__((noinline)) iterateSkipMap(skip_map<Key, Value>& sm) {
+// skip_map looking like a linked-list.
+using flat_skip_map = skip_map<Key,
+                               Value,
+                               std::less<Key>,
+                               std::allocator<skip_map_node<Key, Value>>,
+                               16,
+                               std::ratio<1, 4>,
+                               flat_levels>;
+
+void __attribute__((noinline)) iterateSkipMap(flat_skip_map& sm) {
   for (auto it = sm.begin(); it != sm.end();) {
     benchmark::DoNotOptimize(++it);
   }
@@ -26,13 +39,27 @@ iterateList(std::list<std::pair<Key, Value>>& list) {
     benchmark::DoNotOptimize(++it);
 }
 
+void __attribute__((noinline))
+findSequential(const skip_map<int, int>& sm, const std::vector<int>& keys) {
+  for (auto key : keys) {
+    benchmark::DoNotOptimize(sm.find(key));
+  }
+}
+
+void __attribute__((noinline))
+findInterleaved(const skip_map<int, int>& sm,
+                const std::vector<int>& keys,
+                std::vector<skip_map<int, int>::const_iterator>& found) {
+  sm.find_interleaved(keys.begin(), keys.end(), found.begin());
+  benchmark::DoNotOptimize(found.data());
+}
+
 int main(int argc, char**) {
   // Create a list. Initiliaze key to argc to prevent some optimizations maybe.
   std::list<KeyValue> list(large_size, {argc, long_string});
 
   // Create an equivalent skip_map.
-  skip_map<Key, Value> sm;
-  sm.set_gen_for_testing([]() { return 0; });
+  flat_skip_map sm;
   fill(sm, large_size);
 
   for (int i = 0; i < 1000; ++i) {
@@ -40,5 +67,26 @@ int main(int argc, char**) {
     iterateList(list);
   }
 
+  // Random lookups in a map much larger than the cache, one at a time and
+  // interleaved.
+  std::vector<std::pair<int, int>> data;
+  data.reserve(lookup_map_size);
+  for (int i = 0; i < lookup_map_size; ++i) {
+    data.emplace_back(i, i);
+  }
+  skip_map<int, int> lookup_map(sorted_unique, data.begin(), data.end());
+
+  std::minstd_rand rand(argc);
+  std::vector<int> keys(100000);
+  for (auto& key : keys) {
+    key = rand() % lookup_map_size;
+  }
+  std::vector<skip_map<int, int>::const_iterator> found(keys.size());
+
+  for (int i = 0; i < 10; ++i) {
+    findSequential(lookup_map, keys);
+    findInterleaved(lookup_map, keys, found);
+  }
+
   return 0;
 }
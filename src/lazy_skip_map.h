@@ -0,0 +1,369 @@
+#ifndef lazy_skip_map_h
+#define lazy_skip_map_h
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <optional>
+#include <ratio>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include "atomic_skip_map_node.h"
+#include "epoch_domain.h"
+#include "level_generator.h"
+
+/**
+ * Node of a lazy_skip_map, its atomic links can be read while being relinked.
+ * Each node carries a spinlock taken by the writers relinking around it and
+ * the two flags validated by readers: fully_linked is set once the node is
+ * linked on every level and marked once it is being removed.
+ */
+template <class Key, class T>
+class lazy_skip_map_node
+    : public atomic_skip_map_node<lazy_skip_map_node<Key, T>,
+                                  lazy_skip_map_node<Key, T>*> {
+ public:
+  /**
+   * Test and test-and-set spinlock, only held while relinking.
+   */
+  void lock() {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      while (locked_.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock() { locked_.store(false, std::memory_order_release); }
+
+  std::pair<const Key, T> entry;
+  std::atomic<bool> marked{false};
+  std::atomic<bool> fully_linked{false};
+
+ private:
+  friend class atomic_skip_map_node<lazy_skip_map_node, lazy_skip_map_node*>;
+
+  template <class... Args>
+  explicit lazy_skip_map_node(size_t height, Args&&... arguments)
+      : entry(std::forward<Args>(arguments)...),
+        height_(static_cast<std::uint8_t>(height)) {}
+
+  std::atomic<bool> locked_{false};
+  std::uint8_t height_;
+};
+
+/**
+ * lazy_skip_map is a sorted associative container with unique keys that can be
+ * used from many threads at the same time. It is the lazy skip list of
+ * Herlihy, Lev, Luchangco and Shavit:
+ *
+ * - Lookups take no lock. An element is in the container when its node is
+ *   fully linked and not marked.
+ * - Insertions and erasures lock the predecessors of the node on each level,
+ *   validate that they are still adjacent to it and relink them. Erasures
+ *   lock and mark the node itself first.
+ *
+ * Writers only contend when they touch the same predecessors, readers never
+ * wait. Erased nodes are freed through epoch_domain. It has the same interface
+ * as concurrent_skip_map, mapped values are not modified once inserted and
+ * lookups return copies.
+ */
+template <class Key,
+          class T,
+          class Compare = std::less<Key>,
+          size_t MaxLevel = 16,
+          class Probability = std::ratio<1, 4>>
+class lazy_skip_map {
+ public:
+  static_assert(MaxLevel > 0 && MaxLevel <= 255,
+                "Node heights are stored on a single byte");
+
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using size_type = std::size_t;
+  using key_compare = Compare;
+  using node_type = lazy_skip_map_node<Key, T>;
+
+  lazy_skip_map() : head_(node_type::create(MaxLevel)) {
+    head_->fully_linked = true;
+  }
+
+  lazy_skip_map(const lazy_skip_map&) = delete;
+  lazy_skip_map& operator=(const lazy_skip_map&) = delete;
+
+  /**
+   * No other thread may be using the container anymore. Nodes that were
+   * already unlinked are owned by the epoch domain.
+   */
+  ~lazy_skip_map() {
+    for (auto node = head_; node;) {
+      auto next = node->link(0).load();
+      node_type::destroy(node);
+      node = next;
+    }
+  }
+
+  /**
+   * Inserts value if there is no element with an equivalent key. Returns
+   * whether the insertion took place.
+   */
+  bool insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  /**
+   * If there is no element with a key equivalent to key, inserts an element
+   * with the key and a mapped value constructed from args. Returns whether the
+   * insertion took place.
+   */
+  template <class... Args>
+  bool try_emplace(const key_type& key, Args&&... args) {
+    epoch_domain::guard guard;
+
+    level_nodes_t preds;
+    level_nodes_t succs;
+    node_type* new_node = nullptr;
+    const size_t height = thread_level<MaxLevel, Probability>() + 1;
+
+    for (;;) {
+      if (auto found = find_splice(key, preds, succs)) {
+        if (!found->marked) {
+          // Wait for the insertion in progress to be visible.
+          while (!found->fully_linked) {
+            std::this_thread::yield();
+          }
+          if (new_node) {
+            node_type::destroy(new_node);
+          }
+          return false;
+        }
+        // Being removed, try again once it is unlinked.
+        continue;
+      }
+
+      // Nothing can throw while the predecessors are locked.
+      if (!new_node) {
+        new_node = node_type::create(
+            height, std::piecewise_construct, std::forward_as_tuple(key),
+            std::forward_as_tuple(std::forward<Args>(args)...));
+      }
+      for (size_t level = 0; level < height; ++level) {
+        new_node->link(level).store(succs[level], std::memory_order_relaxed);
+      }
+
+      bool valid = lock_predecessors(preds, height, [&](size_t level) {
+        auto pred = preds[level];
+        auto succ = succs[level];
+        return !pred->marked && (!succ || !succ->marked) &&
+               pred->link(level).load() == succ;
+      });
+      if (!valid) {
+        continue;
+      }
+
+      for (size_t level = 0; level < height; ++level) {
+        preds[level]->link(level).store(new_node);
+      }
+      new_node->fully_linked = true;
+      size_.fetch_add(1, std::memory_order_relaxed);
+
+      unlock_predecessors(preds, height);
+      return true;
+    }
+  }
+
+  /**
+   * Removes the element with a key equivalent to key. Returns whether this
+   * call removed it.
+   */
+  bool erase(const key_type& key) {
+    epoch_domain::guard guard;
+
+    level_nodes_t preds;
+    level_nodes_t succs;
+    node_type* victim = nullptr;
+
+    for (;;) {
+      auto found = find_splice(key, preds, succs);
+      if (!victim) {
+        // Nodes not fully linked yet are still being inserted.
+        if (!found || !found->fully_linked || found->marked) {
+          return false;
+        }
+
+        found->lock();
+        if (found->marked) {
+          found->unlock();
+          return false;
+        }
+        found->marked = true;
+        victim = found;
+        size_.fetch_sub(1, std::memory_order_relaxed);
+      }
+
+      const size_t height = victim->height();
+      bool valid = lock_predecessors(preds, height, [&](size_t level) {
+        auto pred = preds[level];
+        return !pred->marked && pred->link(level).load() == victim;
+      });
+      if (!valid) {
+        continue;
+      }
+
+      for (size_t level = height; level-- > 0;) {
+        preds[level]->link(level).store(victim->link(level).load());
+      }
+      victim->unlock();
+      unlock_predecessors(preds, height);
+
+      epoch_domain::instance().retire(victim, &node_type::destroy);
+      return true;
+    }
+  }
+
+  /**
+   * Checks if there is an element with a key equivalent to key.
+   */
+  bool contains(const key_type& key) const {
+    epoch_domain::guard guard;
+    auto node = search(key);
+    return node && !key_comparator_(key, node->entry.first);
+  }
+
+  /**
+   * Returns a copy of the mapped value of the element with a key equivalent
+   * to key, if any.
+   */
+  std::optional<T> find(const key_type& key) const {
+    epoch_domain::guard guard;
+    auto node = search(key);
+    if (node && !key_comparator_(key, node->entry.first)) {
+      return node->entry.second;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Returns a copy of the first element that is not less than key, if any.
+   */
+  std::optional<value_type> lower_bound(const key_type& key) const {
+    epoch_domain::guard guard;
+    if (auto node = search(key)) {
+      return node->entry;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Calls f on every element in order. Elements inserted or erased during the
+   * walk may or may not be seen.
+   */
+  template <class F>
+  void for_each(F&& f) const {
+    epoch_domain::guard guard;
+    for (auto node = head_->link(0).load(); node; node = node->link(0).load()) {
+      if (is_present(node)) {
+        f(static_cast<const value_type&>(node->entry));
+      }
+    }
+  }
+
+  /**
+   * Number of elements. Exact only when no modification is in progress.
+   */
+  size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+  bool empty() const { return size() == 0; }
+
+ private:
+  using level_nodes_t = std::array<node_type*, MaxLevel>;
+
+  static bool is_present(const node_type* node) {
+    return node->fully_linked && !node->marked;
+  }
+
+  /**
+   * Fills preds and succs with the last node before key and the first node
+   * not before it on every level, without locking. Returns the node holding
+   * key found on the highest level, if any.
+   */
+  node_type* find_splice(const Key& key,
+                         level_nodes_t& preds,
+                         level_nodes_t& succs) const {
+    node_type* found = nullptr;
+    node_type* pred = head_;
+    for (size_t level = MaxLevel; level-- > 0;) {
+      auto curr = pred->link(level).load();
+      while (curr && key_comparator_(curr->entry.first, key)) {
+        pred = curr;
+        curr = curr->link(level).load();
+      }
+      if (!found && curr && !key_comparator_(key, curr->entry.first)) {
+        found = curr;
+      }
+      preds[level] = pred;
+      succs[level] = curr;
+    }
+    return found;
+  }
+
+  /**
+   * Returns the first present node not before key.
+   */
+  const node_type* search(const Key& key) const {
+    const node_type* pred = head_;
+    const node_type* curr = nullptr;
+    for (size_t level = MaxLevel; level-- > 0;) {
+      curr = pred->link(level).load();
+      while (curr && key_comparator_(curr->entry.first, key)) {
+        pred = curr;
+        curr = curr->link(level).load();
+      }
+    }
+    while (curr && !is_present(curr)) {
+      curr = curr->link(0).load();
+    }
+    return curr;
+  }
+
+  /**
+   * Locks preds from level 0 up to height and checks valid(level) on each
+   * level. The same node can be the predecessor on consecutive levels and is
+   * locked once. Locking from the bottom up takes the locks in decreasing key
+   * order in every thread. On failure nothing is left locked.
+   */
+  template <class Validate>
+  static bool lock_predecessors(level_nodes_t& preds,
+                                size_t height,
+                                Validate valid) {
+    for (size_t level = 0; level < height; ++level) {
+      if (level == 0 || preds[level] != preds[level - 1]) {
+        preds[level]->lock();
+      }
+      if (!valid(level)) {
+        unlock_predecessors(preds, level + 1);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  static void unlock_predecessors(level_nodes_t& preds, size_t height) {
+    for (size_t level = 0; level < height; ++level) {
+      if (level == 0 || preds[level] != preds[level - 1]) {
+        preds[level]->unlock();
+      }
+    }
+  }
+
+  node_type* head_;
+  std::atomic<size_type> size_{0};
+  key_compare key_comparator_;
+};
+
+#endif /* lazy_skip_map_h */
@@ -0,0 +1,123 @@
+#ifndef level_generator_h
+#define level_generator_h
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <ratio>
+
+/**
+ * Default level generator of the skip maps. Levels are in [0, MaxLevel - 1],
+ * a node is promoted to the next level with probability Probability.
+ *
+ * The state is a single xorshift64* word. When Probability is 1/2^k, a draw is
+ * one step of the generator and the level is the number of leading zero bits
+ * of the output divided by k: each group of k zero bits has probability
+ * 1/2^k. Other probabilities compare one draw per level to a threshold.
+ *
+ * Generators built with the same seed produce the same levels, so maps filled
+ * in the same order get the same structure. The default seed differs between
+ * instances and runs.
+ */
+template <size_t MaxLevel, class Probability>
+class xorshift_level_generator {
+ public:
+  static_assert(MaxLevel > 0, "Need at least one level");
+  static_assert(Probability::num > 0 && Probability::num < Probability::den,
+                "Probability has to be in ]0, 1[");
+
+  xorshift_level_generator() : xorshift_level_generator(default_seed()) {}
+
+  explicit xorshift_level_generator(uint64_t seed) : state_(mix(seed)) {
+    // xorshift never leaves the all zero state.
+    if (state_ == 0) {
+      state_ = 0x9e3779b97f4a7c15;
+    }
+  }
+
+  size_t operator()() {
+    if constexpr (bits_per_level > 0) {
+      // The top bits of the product are the best ones, the lowest bit set
+      // keeps the count defined.
+      const size_t level = leading_zeros(next() | 1) / bits_per_level;
+      return level < MaxLevel - 1 ? level : MaxLevel - 1;
+    } else {
+      size_t level = 0;
+      while (level < MaxLevel - 1 && next() < threshold) {
+        ++level;
+      }
+      return level;
+    }
+  }
+
+ private:
+  // k when Probability is 1/2^k, 0 otherwise.
+  static constexpr size_t log2_inverse(intmax_t den) {
+    size_t k = 0;
+    while (den > 1 && den % 2 == 0) {
+      den /= 2;
+      ++k;
+    }
+    return den == 1 ? k : 0;
+  }
+
+  static constexpr size_t bits_per_level =
+      Probability::num == 1 ? log2_inverse(Probability::den) : 0;
+
+  static constexpr uint64_t threshold =
+      std::numeric_limits<uint64_t>::max() / Probability::den *
+      Probability::num;
+
+  // Number of leading zero bits of a non zero x.
+  static size_t leading_zeros(uint64_t x) {
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    size_t count = 0;
+    for (size_t shift = 32; shift > 0; shift /= 2) {
+      if ((x >> (64 - shift)) == 0) {
+        x <<= shift;
+        count += shift;
+      }
+    }
+    return count;
+#endif
+  }
+
+  uint64_t next() {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545f4914f6cdd1d;
+  }
+
+  // splitmix64 finalizer, spreads close seeds over the whole state.
+  static uint64_t mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+  }
+
+  // Consecutive seeds from a random start, drawn once per process.
+  static uint64_t default_seed() {
+    static std::atomic<uint64_t> next_seed{
+        (uint64_t(std::random_device()()) << 32) | std::random_device()()};
+    return next_seed.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  uint64_t state_;
+};
+
+/**
+ * Draws a level from a xorshift_level_generator owned by the calling thread,
+ * for the containers written to from many threads at once.
+ */
+template <size_t MaxLevel, class Probability>
+size_t thread_level() {
+  thread_local xorshift_level_generator<MaxLevel, Probability> levels;
+  return levels();
+}
+
+#endif /* level_generator_h */
@@ -0,0 +1,384 @@
+#ifndef mapped_skip_map_h
+#define mapped_skip_map_h
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <type_traits>
+
+/**
+ * Element stored in a mapped_skip_map file.
+ */
+template <class Key, class T>
+struct mapped_skip_map_entry {
+  Key first;
+  T second;
+};
+
+/**
+ * Header at the start of a mapped_skip_map file. Files are only read on
+ * machines with the byte order and the type layouts of the writer.
+ */
+struct mapped_skip_map_header {
+  static constexpr char expected_magic[8] = {'s', 'k', 'i', 'p',
+                                             'm', 'a', 'p', '\0'};
+  static constexpr std::uint32_t current_format = 1;
+
+  char magic[8];
+  std::uint32_t format;
+  std::uint32_t levels;
+  std::uint64_t key_size;
+  std::uint64_t entry_size;
+  std::uint64_t size;
+  std::uint64_t head;
+};
+
+/**
+ * mapped_skip_map is a read-only view of a skip list stored in a file by
+ * write(). The file is mapped in memory and searched where it lies, opening
+ * it costs the same whatever its size and its pages are shared by every
+ * process mapping it.
+ *
+ * Nodes follow the header in key order, each one made of its tower of links
+ * followed by its entry like skip_map_node. Links are offsets of entries from
+ * the start of the file, 0 being null. The head is a tower of header.levels
+ * links without entry. Towers are not random: node i is on every level l
+ * where 4^l divides i + 1. The list is perfectly balanced and the position of
+ * every node follows from its index, so write() streams the file in a single
+ * pass without seeking back.
+ *
+ * Keys and mapped values have to be trivially copyable.
+ */
+template <class Key, class T, class Compare = std::less<Key>>
+class mapped_skip_map {
+ public:
+  static_assert(std::is_trivially_copyable<Key>::value &&
+                    std::is_trivially_copyable<T>::value,
+                "Keys and values are stored as their bytes");
+
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = mapped_skip_map_entry<Key, T>;
+  using size_type = std::size_t;
+  using key_compare = Compare;
+
+  static_assert(alignof(value_type) <= sizeof(std::uint64_t),
+                "Entries are aligned on their links");
+
+  /**
+   * Forward iterator over the entries of the file.
+   */
+  class const_iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = mapped_skip_map::value_type;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const value_type*;
+    using reference = const value_type&;
+
+    const_iterator() = default;
+
+    reference operator*() const { return *entry(node_); }
+    pointer operator->() const { return entry(node_); }
+
+    const_iterator& operator++() {
+      node_ = next(base_, node_, 0);
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp(*this);
+      operator++();
+      return tmp;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return node_ == other.node_;
+    }
+    bool operator!=(const const_iterator& other) const {
+      return node_ != other.node_;
+    }
+
+   private:
+    friend class mapped_skip_map;
+
+    const_iterator(const unsigned char* base, const unsigned char* node)
+        : base_(base), node_(node) {}
+
+    const unsigned char* base_ = nullptr;
+    const unsigned char* node_ = nullptr;
+  };
+
+  using iterator = const_iterator;
+
+  /**
+   * Maps the file at path. Throws std::system_error when it cannot be mapped
+   * and std::runtime_error when it was not written by write() for these
+   * types.
+   */
+  explicit mapped_skip_map(const std::string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), path);
+    }
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      int error = errno;
+      ::close(fd);
+      throw std::system_error(error, std::generic_category(), path);
+    }
+    length_ = st.st_size;
+    if (length_ < sizeof(mapped_skip_map_header)) {
+      ::close(fd);
+      throw std::runtime_error(path + ": not a mapped_skip_map file");
+    }
+    void* address = ::mmap(nullptr, length_, PROT_READ, MAP_SHARED, fd, 0);
+    int error = errno;
+    ::close(fd);
+    if (address == MAP_FAILED) {
+      throw std::system_error(error, std::generic_category(), path);
+    }
+    base_ = static_cast<const unsigned char*>(address);
+
+    std::memcpy(&header_, base_, sizeof(header_));
+    if (!valid_header(header_, length_)) {
+      ::munmap(const_cast<unsigned char*>(base_), length_);
+      throw std::runtime_error(path + ": not a mapped_skip_map file");
+    }
+  }
+
+  mapped_skip_map(mapped_skip_map&& other) noexcept
+      : base_(other.base_), length_(other.length_), header_(other.header_) {
+    other.base_ = nullptr;
+  }
+
+  mapped_skip_map& operator=(mapped_skip_map&& other) noexcept {
+    std::swap(base_, other.base_);
+    std::swap(length_, other.length_);
+    std::swap(header_, other.header_);
+    return *this;
+  }
+
+  ~mapped_skip_map() {
+    if (base_) {
+      ::munmap(const_cast<unsigned char*>(base_), length_);
+    }
+  }
+
+  /**
+   * Writes the elements of map, in order, in the format mapped by
+   * mapped_skip_map. map can be any sorted container of unique keys with
+   * first and second members, for instance a skip_map.
+   */
+  template <class Map>
+  static void write(std::ostream& out, const Map& map) {
+    const std::uint64_t size = map.size();
+    mapped_skip_map_header header{};
+    std::memcpy(header.magic, mapped_skip_map_header::expected_magic,
+                sizeof(header.magic));
+    header.format = mapped_skip_map_header::current_format;
+    header.levels = levels_for(size);
+    header.key_size = sizeof(Key);
+    header.entry_size = sizeof(value_type);
+    header.size = size;
+    header.head = sizeof(header) + header.levels * link_size;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    // Level l of the head links to node 4^l - 1.
+    for (size_t level = header.levels; level-- > 0;) {
+      write_link(out, header, (std::uint64_t(1) << (2 * level)) - 1);
+    }
+
+    std::uint64_t index = 0;
+    for (const auto& element : map) {
+      // Level l of node i links to node i + 4^l.
+      const size_t height = height_of(index, header.levels);
+      for (size_t level = height; level-- > 0;) {
+        write_link(out, header, index + (std::uint64_t(1) << (2 * level)));
+      }
+
+      alignas(value_type) unsigned char entry[entry_stride] = {};
+      ::new (entry) value_type{element.first, element.second};
+      out.write(reinterpret_cast<const char*>(entry), entry_stride);
+      ++index;
+    }
+  }
+
+  const_iterator begin() const { return {base_, next(base_, head(), 0)}; }
+  const_iterator end() const { return {base_, nullptr}; }
+  const_iterator cbegin() const { return begin(); }
+  const_iterator cend() const { return end(); }
+
+  /**
+   * Returns the element with a key equivalent to key, or end().
+   */
+  const_iterator find(const key_type& key) const {
+    auto node = lower_bound_node(key);
+    if (node && !key_comparator_(key, entry(node)->first)) {
+      return {base_, node};
+    }
+    return end();
+  }
+
+  const_iterator lower_bound(const key_type& key) const {
+    return {base_, lower_bound_node(key)};
+  }
+
+  const_iterator upper_bound(const key_type& key) const {
+    auto node = lower_bound_node(key);
+    if (node && !key_comparator_(key, entry(node)->first)) {
+      node = next(base_, node, 0);
+    }
+    return {base_, node};
+  }
+
+  bool contains(const key_type& key) const { return find(key) != end(); }
+
+  size_type count(const key_type& key) const { return contains(key) ? 1 : 0; }
+
+  /**
+   * Returns the mapped value of key, throws std::out_of_range if there is
+   * none.
+   */
+  const T& at(const key_type& key) const {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("mapped_skip_map::at");
+    }
+    return it->second;
+  }
+
+  size_type size() const { return header_.size; }
+
+  bool empty() const { return header_.size == 0; }
+
+  /**
+   * Number of levels of the list, the height of the head.
+   */
+  size_t levels() const { return header_.levels; }
+
+ private:
+  static constexpr size_t link_size = sizeof(std::uint64_t);
+  static constexpr size_t max_levels = 32;
+  static constexpr size_t entry_stride =
+      (sizeof(value_type) + link_size - 1) / link_size * link_size;
+
+  /**
+   * Enough levels for the top one to hold a node.
+   */
+  static std::uint32_t levels_for(std::uint64_t size) {
+    std::uint32_t levels = 1;
+    while (levels < max_levels &&
+           (std::uint64_t(1) << (2 * levels)) <= size) {
+      ++levels;
+    }
+    return levels;
+  }
+
+  // Number of levels l under levels where 4^l divides index + 1.
+  static size_t height_of(std::uint64_t index, size_t levels) {
+    size_t height = 1;
+    while (height < levels && ((index + 1) >> (2 * height) << (2 * height)) ==
+                                  index + 1) {
+      ++height;
+    }
+    return height;
+  }
+
+  // Links in the towers of the nodes before index: node i is on level l for
+  // every l where 4^l divides i + 1, which happens index / 4^l times.
+  static std::uint64_t links_before(std::uint64_t index, size_t levels) {
+    std::uint64_t links = 0;
+    for (size_t level = 0; level < levels; ++level) {
+      links += index >> (2 * level);
+    }
+    return links;
+  }
+
+  // Offset of the entry of node index.
+  static std::uint64_t offset_of(const mapped_skip_map_header& header,
+                                 std::uint64_t index) {
+    return header.head + index * entry_stride +
+           (links_before(index, header.levels) +
+            height_of(index, header.levels)) *
+               link_size;
+  }
+
+  static std::uint64_t file_size(std::uint64_t size, size_t levels) {
+    return sizeof(mapped_skip_map_header) + levels * link_size +
+           size * entry_stride + links_before(size, levels) * link_size;
+  }
+
+  /**
+   * Checks that header describes a file of length bytes written by write()
+   * for these types. The layout fields are checked before they are used in
+   * any computation, a corrupt header cannot make the links point outside of
+   * the file.
+   */
+  static bool valid_header(const mapped_skip_map_header& header,
+                           std::uint64_t length) {
+    return std::memcmp(header.magic, mapped_skip_map_header::expected_magic,
+                       sizeof(header.magic)) == 0 &&
+           header.format == mapped_skip_map_header::current_format &&
+           header.key_size == sizeof(Key) &&
+           header.entry_size == sizeof(value_type) &&
+           header.size <= length / entry_stride && header.levels >= 1 &&
+           header.levels <= max_levels &&
+           header.levels == levels_for(header.size) &&
+           header.head == sizeof(header) + header.levels * link_size &&
+           file_size(header.size, header.levels) == length;
+  }
+
+  static void write_link(std::ostream& out,
+                         const mapped_skip_map_header& header,
+                         std::uint64_t index) {
+    const std::uint64_t link =
+        index < header.size ? offset_of(header, index) : 0;
+    out.write(reinterpret_cast<const char*>(&link), sizeof(link));
+  }
+
+  static const value_type* entry(const unsigned char* node) {
+    return reinterpret_cast<const value_type*>(node);
+  }
+
+  static const unsigned char* next(const unsigned char* base,
+                                   const unsigned char* node,
+                                   size_t level) {
+    std::uint64_t link;
+    std::memcpy(&link, node - (level + 1) * link_size, sizeof(link));
+    return link ? base + link : nullptr;
+  }
+
+  const unsigned char* head() const { return base_ + header_.head; }
+
+  const unsigned char* lower_bound_node(const key_type& key) const {
+    const unsigned char* pred = head();
+    const unsigned char* curr = nullptr;
+    for (size_t level = header_.levels; level-- > 0;) {
+      curr = next(base_, pred, level);
+      while (curr && key_comparator_(entry(curr)->first, key)) {
+        pred = curr;
+        curr = next(base_, curr, level);
+      }
+    }
+    return curr;
+  }
+
+  const unsigned char* base_;
+  size_t length_;
+  mapped_skip_map_header header_;
+  key_compare key_comparator_;
+};
+
+#endif /* mapped_skip_map_h */
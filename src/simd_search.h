@@ -0,0 +1,181 @@
+#ifndef simd_search_h
+#define simd_search_h
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Whether keys of type Key ordered by Compare can be searched with
+ * simd_lower_bound(): 32 or 64 bit integers in the order of std::less. Other
+ * keys and custom comparators have to use the generic search.
+ */
+template <class Key, class Compare>
+inline constexpr bool is_simd_searchable_v =
+    std::is_integral_v<Key> && !std::is_same_v<Key, bool> &&
+    (sizeof(Key) == 4 || sizeof(Key) == 8) &&
+    (std::is_same_v<Compare, std::less<Key>> ||
+     std::is_same_v<Compare, std::less<>>);
+
+/**
+ * lower_bound over size sorted keys without branches depending on the keys,
+ * the comparison compiles to a conditional move.
+ */
+template <class Key>
+size_t branchless_lower_bound(const Key* keys, size_t size, Key key) {
+  if (size == 0) {
+    return 0;
+  }
+
+  const Key* base = keys;
+  while (size > 1) {
+    const size_t half = size / 2;
+    base = base[half] < key ? base + half : base;
+    size -= half;
+  }
+  return (base - keys) + (*base < key);
+}
+
+namespace simd_search_detail {
+
+// Bits of a movemask covering the lanes of [first, size).
+inline unsigned valid_lanes(size_t first, size_t size, size_t lanes) {
+  const size_t count = size - first < lanes ? size - first : lanes;
+  return static_cast<unsigned>((uint64_t(1) << count) - 1);
+}
+
+#if defined(__AVX2__)
+
+inline __m256i bias(__m256i keys, __m256i flip) {
+  return _mm256_xor_si256(keys, flip);
+}
+
+template <class Key>
+size_t count_less(const Key* keys, size_t size, size_t capacity, Key key) {
+  using signed_key = std::make_signed_t<Key>;
+  constexpr size_t lanes = 32 / sizeof(Key);
+
+  // Unsigned keys are compared as signed ones with their sign bit flipped.
+  const signed_key sign = std::is_signed_v<Key>
+                              ? signed_key(0)
+                              : signed_key(Key(1) << (sizeof(Key) * 8 - 1));
+  __m256i flip;
+  __m256i needle;
+  if constexpr (sizeof(Key) == 4) {
+    flip = _mm256_set1_epi32(sign);
+    needle = _mm256_set1_epi32(static_cast<signed_key>(key));
+  } else {
+    flip = _mm256_set1_epi64x(sign);
+    needle = _mm256_set1_epi64x(static_cast<signed_key>(key));
+  }
+  needle = bias(needle, flip);
+
+  size_t count = 0;
+  size_t i = 0;
+  for (; i < size && i + lanes <= capacity; i += lanes) {
+    auto chunk = bias(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i)), flip);
+    unsigned mask;
+    if constexpr (sizeof(Key) == 4) {
+      mask = _mm256_movemask_ps(
+          _mm256_castsi256_ps(_mm256_cmpgt_epi32(needle, chunk)));
+    } else {
+      mask = _mm256_movemask_pd(
+          _mm256_castsi256_pd(_mm256_cmpgt_epi64(needle, chunk)));
+    }
+    count += __builtin_popcount(mask & valid_lanes(i, size, lanes));
+  }
+
+  // What does not fill a whole vector within capacity.
+  for (; i < size; ++i) {
+    count += keys[i] < key;
+  }
+  return count;
+}
+
+#elif defined(__SSE2__)
+
+template <class Key>
+size_t count_less(const Key* keys, size_t size, size_t capacity, Key key) {
+  using signed_key = std::make_signed_t<Key>;
+  constexpr size_t lanes = 16 / sizeof(Key);
+
+  // Unsigned keys are compared as signed ones with their sign bit flipped.
+  const signed_key sign = std::is_signed_v<Key>
+                              ? signed_key(0)
+                              : signed_key(Key(1) << (sizeof(Key) * 8 - 1));
+  __m128i flip;
+  __m128i needle;
+  if constexpr (sizeof(Key) == 4) {
+    flip = _mm_set1_epi32(sign);
+    needle = _mm_set1_epi32(static_cast<signed_key>(key));
+  } else {
+    flip = _mm_set1_epi64x(sign);
+    needle = _mm_set1_epi64x(static_cast<signed_key>(key));
+  }
+  needle = _mm_xor_si128(needle, flip);
+
+  size_t count = 0;
+  size_t i = 0;
+  for (; i < size && i + lanes <= capacity; i += lanes) {
+    auto chunk = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(keys + i)), flip);
+    unsigned mask;
+    if constexpr (sizeof(Key) == 4) {
+      mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(needle, chunk)));
+    } else {
+      mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(needle, chunk)));
+    }
+    count += __builtin_popcount(mask & valid_lanes(i, size, lanes));
+  }
+
+  // What does not fill a whole vector within capacity.
+  for (; i < size; ++i) {
+    count += keys[i] < key;
+  }
+  return count;
+}
+
+#endif
+
+}  // namespace simd_search_detail
+
+/**
+ * Returns the index of the first of the size sorted keys that is not less
+ * than key. Since the keys are sorted, it is the number of keys less than
+ * key: whole vectors of keys are compared to key at once and the matches are
+ * counted from the movemask, without any branch on the keys. AVX2 is used
+ * when enabled, SSE2 otherwise. 64 bit keys need SSE4.2 besides SSE2, other
+ * architectures use branchless_lower_bound().
+ *
+ * keys has to be readable up to capacity elements, the lanes past size are
+ * loaded but ignored.
+ */
+template <class Key>
+size_t simd_lower_bound(const Key* keys,
+                        size_t size,
+                        size_t capacity,
+                        Key key) {
+  static_assert(is_simd_searchable_v<Key, std::less<Key>>,
+                "Only 32 and 64 bit integers are supported");
+#if defined(__AVX2__) || defined(__SSE4_2__)
+  return simd_search_detail::count_less(keys, size, capacity, key);
+#elif defined(__SSE2__)
+  if constexpr (sizeof(Key) == 4) {
+    return simd_search_detail::count_less(keys, size, capacity, key);
+  } else {
+    (void)capacity;
+    return branchless_lower_bound(keys, size, key);
+  }
+#else
+  (void)capacity;
+  return branchless_lower_bound(keys, size, key);
+#endif
+}
+
+#endif /* simd_search_h */
@@ -2,29 +2,138 @@
 #define skip_map_h
 
 #include <gtest/gtest_prod.h>
+#include <algorithm>
 #include <array>
 #include <exception>
 #include <functional>
+#include <initializer_list>
+#include <istream>
+#include <iterator>
 #include <limits>
-#include <random>
+#include <ostream>
+#include <ratio>
 #include <stdexcept>
-#include "distribution.hpp"
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "level_generator.h"
+#include "skip_map_codec.h"
 #include "skip_map_iterator.h"
 #include "skip_map_node.h"
-#include "test_facilities.hpp"
+
+/**
+ * Tag used to indicate that a range is already sorted by the comparison
+ * function and does not contain equivalent keys.
+ */
+struct sorted_unique_t {
+  explicit sorted_unique_t() = default;
+};
+inline constexpr sorted_unique_t sorted_unique{};
+
+/**
+ * Structure of a skip_map as reported by skip_map::stats(). Vectors indexed by
+ * level have max_level + 1 entries.
+ */
+struct skip_map_stats {
+  /**
+   * Number of elements and highest level in use.
+   */
+  size_t size = 0;
+  size_t max_level = 0;
+
+  /**
+   * Number of nodes linked on each level, nodes_per_level[0] is size.
+   */
+  std::vector<size_t> nodes_per_level;
+
+  /**
+   * height_histogram[i] is the number of nodes with a tower of i + 1 links.
+   */
+  std::vector<size_t> height_histogram;
+
+  /**
+   * Nodes passed on each level by the sampled searches, on average and at
+   * most. A level where searches keep walking far is a degenerate one.
+   */
+  size_t sampled_searches = 0;
+  std::vector<double> average_hops;
+  std::vector<size_t> max_hops;
+
+  /**
+   * Bytes allocated for the nodes, sentinels included, and the part of them
+   * taken by the towers of links.
+   */
+  size_t node_bytes = 0;
+  size_t link_bytes = 0;
+};
+
+/**
+ * Detects allocators able to free all their memory at once through a
+ * try_release() member, like skip_map_arena_allocator.
+ */
+template <class Alloc, class = void>
+struct has_try_release : std::false_type {};
+
+template <class Alloc>
+struct has_try_release<
+    Alloc,
+    std::void_t<decltype(std::declval<Alloc&>().try_release())>>
+    : std::true_type {};
+
+/**
+ * Detects allocators taking over the destruction of the nodes through a
+ * retire() member, like skip_map_epoch_allocator.
+ */
+template <class Alloc, class Node, class = void>
+struct has_retire : std::false_type {};
+
+template <class Alloc, class Node>
+struct has_retire<
+    Alloc,
+    Node,
+    std::void_t<decltype(std::declval<Alloc&>().retire(
+        std::declval<Node*>()))>> : std::true_type {};
 
 /**
  * skip_map is a sorted associative container that contains key-value pairs with
  * unique keys. Keys are sorted by using the comparison function Compare.
  * Search, removal, and insertion operations have expected logarithmic
  * complexity. skip_map is implemented using a skip_list.
+ *
+ * MaxLevel is the highest tower a node can get and Probability is the odds for
+ * a node to be promoted to the next level. The expected number of levels used
+ * is log(n) in base 1/Probability, the defaults stay logarithmic up to about
+ * 4^16 elements.
+ *
+ * LevelGenerator draws the level of each inserted node: a callable returning
+ * values in [0, MaxLevel - 1], promoting with probability Probability for the
+ * complexity to hold. The default is cheap and can be seeded for reproducible
+ * structures.
+ *
+ * When Indexed is true every link also stores its width, the number of
+ * elements it skips on the bottom level, in front of the tower of links. It
+ * costs a word per link and keeping the widths up to date on insertion and
+ * erasure, for nth(), rank() and distance() in O(log n).
+ *
+ * When Bidirectional is true every node also links to the previous one on the
+ * bottom level, the iterators are bidirectional and rbegin() is O(1). It
+ * costs a pointer per node.
  */
 template <class Key,
           class T,
-          class Compare = compare_with_stats<Key>,
-          class Allocator = std::allocator<skip_map_node<Key, T>>>
+          class Compare = std::less<Key>,
+          class Allocator = std::allocator<skip_map_node<Key, T>>,
+          size_t MaxLevel = 16,
+          class Probability = std::ratio<1, 4>,
+          class LevelGenerator =
+              xorshift_level_generator<MaxLevel, Probability>,
+          bool Indexed = false,
+          bool Bidirectional = false>
 class skip_map {
  public:
+  static_assert(MaxLevel > 0 && MaxLevel <= 255,
+                "Node heights are stored on a single byte");
+
   using key_type = Key;
   using mapped_type = T;
   using value_type = std::pair<const Key, T>;
@@ -32,41 +141,122 @@ class skip_map {
   using difference_type = std::ptrdiff_t;
   using key_compare = Compare;
   using allocator_type = Allocator;
+  using level_generator_type = LevelGenerator;
   using reference = value_type&;
   using const_reference = const value_type&;
   using pointer = typename std::allocator_traits<Allocator>::pointer;
   using const_pointer =
       typename std::allocator_traits<Allocator>::const_pointer;
 
-  using iterator = skip_map_iterator<Key, T, false>;
-  using const_iterator = skip_map_iterator<Key, T, true>;
-
-  using splice_t = fixed_vector<iterator, MAX_SIZE>;
-  using const_splice_t = fixed_vector<const_iterator, MAX_SIZE>;
+  using iterator = skip_map_iterator<Key, T, false, Bidirectional>;
+  using const_iterator = skip_map_iterator<Key, T, true, Bidirectional>;
+  using reverse_iterator = std::reverse_iterator<iterator>;
+  using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
   using node_type = skip_map_node<Key, T>;
 
+  /**
+   * One node per level, indexed by level. Used to hold the predecessors of a
+   * position in the list.
+   */
+  using level_nodes_t = std::array<node_type*, MaxLevel>;
+
+  /**
+   * Nodes are allocated as a run of blocks holding the tower and the node, the
+   * provided allocator is rebound to allocate those blocks.
+   */
+  using node_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<typename node_type::block>;
+
+  static_assert(!(Indexed || Bidirectional) ||
+                    !has_retire<node_allocator_type, node_type>::value,
+                "Retired nodes are released without their back link and "
+                "widths");
+
   /**
    * Default constructor
    */
   skip_map()
-      : rend_(allocate_and_init()), end_(allocate_and_init()), max_level_(0) {
-    // Fill terminal nodes with nulls as the will never be filled organically.
-    end_->initialize_to_null();
-    rend_->initialize_to_null();
-
+      : rend_(allocate_and_init(MaxLevel)),
+        end_(allocate_and_init(MaxLevel)),
+        max_level_(0),
+        size_(0) {
+    // Terminal nodes get a full tower of nulls as they will never be filled
+    // organically.
     rend_->set_link(0, end_);
+    set_width(rend_, 0, 1);
+    set_prev(end_, rend_);
+    finger_.fill(rend_);
+  }
+
+  /**
+   * Constructs an empty container drawing node levels from levels, e.g. a
+   * generator with a fixed seed.
+   */
+  explicit skip_map(const LevelGenerator& levels) : skip_map() {
+    levels_ = levels;
+  }
+
+  /**
+   * Constructs the container with the contents of the range [first, last). If
+   * multiple elements have equivalent keys only the first one is inserted.
+   */
+  template <class InputIt>
+  skip_map(InputIt first, InputIt last) : skip_map() {
+    insert(first, last);
+  }
+
+  /**
+   * Constructs the container with the contents of ilist.
+   */
+  skip_map(std::initializer_list<value_type> ilist) : skip_map() {
+    insert(ilist);
+  }
+
+  /**
+   * Constructs the container with the contents of the range [first, last)
+   * which has to be sorted by Compare without equivalent keys. The towers are
+   * built in a single pass in linear time.
+   */
+  template <class InputIt>
+  skip_map(sorted_unique_t, InputIt first, InputIt last) : skip_map() {
+    append_sorted(first, last, tail_nodes());
   }
 
   /**
-   * Copy constructor, performs a deep copy of the data in rhs
+   * Copy constructor, performs a deep copy of the data in rhs. The list of rhs
+   * is walked once and every node is copied with the same height, so the copy
+   * has the exact same structure without any search or random draw.
    */
-  skip_map(const skip_map& rhs) : skip_map() {
-    // TODO : Copy the max level and just do a regular walk and copy. Much
-    // faster.
-    for (const auto& key_value : rhs) {
-      insert(key_value);
+  skip_map(const skip_map& rhs)
+      : allocator_(std::allocator_traits<node_allocator_type>::
+                       select_on_container_copy_construction(rhs.allocator_)),
+        rend_(allocate_and_init(MaxLevel)),
+        end_(allocate_and_init(MaxLevel)),
+        max_level_(0),
+        size_(0),
+        key_comparator_(rhs.key_comparator_),
+        levels_(rhs.levels_) {
+    rend_->set_link(0, end_);
+    set_width(rend_, 0, 1);
+    set_prev(end_, rend_);
+    raise_max_level(rhs.max_level_);
+
+    auto tail = tail_nodes();
+    try {
+      for (auto node = rhs.rend_->link_at(0); node != rhs.end_;
+           node = node->link_at(0)) {
+        append_node(tail, allocate_and_init(node->height(), node->entry.first,
+                                            node->entry.second));
+      }
+    } catch (...) {
+      // The destructor does not run for a constructor that throws.
+      release_nodes();
+      destroy_and_release(rend_);
+      destroy_and_release(end_);
+      throw;
     }
+    finger_ = tail;
   }
 
   /**
@@ -74,14 +264,23 @@ class skip_map {
    * assignable and destructible by setting its pointer to null
    */
   skip_map(skip_map&& rhs)
-      : rend_(rhs.rend_), end_(rhs.end_), max_level_(rhs.max_level_) {
+      : allocator_(rhs.allocator_),
+        rend_(rhs.rend_),
+        end_(rhs.end_),
+        max_level_(rhs.max_level_),
+        size_(rhs.size_),
+        finger_(rhs.finger_),
+        key_comparator_(std::move(rhs.key_comparator_)),
+        levels_(std::move(rhs.levels_)) {
     rhs.rend_ = nullptr;
     rhs.end_ = nullptr;
+    rhs.size_ = 0;
   }
 
   /**
    * Copy assignement operator. Uses the copy and swap idiom. rhs is received by
-   * copy which takes care of performing a deep copy of the data. This also
+   * copy which takes care of performing a deep copy of the data, in linear time
+   * through the copy constructor. This also
    * saves us from defining a move assignement operator since rhs will be move
    * constructed when the operator is invoked with an r-value.
    */
@@ -94,7 +293,19 @@ class skip_map {
    * Clears all data to relase ressources
    */
   ~skip_map() {
-    clear();
+    // Nothing has to be destroyed, if the allocator can drop all its memory at
+    // once there is no need to walk the nodes.
+    if constexpr (has_try_release<node_allocator_type>::value &&
+                  std::is_trivially_destructible_v<value_type>) {
+      if (allocator_.try_release()) {
+        return;
+      }
+    }
+
+    // If we have a null first pointer it's because the contents were moved out
+    if (rend_) {
+      release_nodes();
+    }
     destroy_and_release(rend_);
     destroy_and_release(end_);
   }
@@ -135,27 +346,38 @@ class skip_map {
    * const overload of find()
    */
   const_iterator find(const Key& key) const {
-    auto lower_bound_it = lower_bound(key);
-    if (!key_comparator_(key, lower_bound_it->first) &&
-        lower_bound_it != end()) {
-      return lower_bound_it;
-    } else {
-      return end();
-    }
+    return const_iterator(find_node(key));
+  }
+
+  /**
+   * Finds an element with a key that compares equivalent to key, without
+   * converting key to key_type. Only when Compare is transparent, e.g.
+   * std::less<> to look up std::string keys with a std::string_view.
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  iterator find(const K& key) {
+    return iterator(find_node(key));
+  }
+
+  /**
+   * const overload of the transparent find()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  const_iterator find(const K& key) const {
+    return const_iterator(find_node(key));
   }
 
   /**
    * Returns a reference to the value that is mapped to a key equivalent to key,
    * performing an insertion if such key does not already exist.
    */
-  T& operator[](const Key& key) {
-    auto it = find(key);
-    if (it != end()) {
-      return it->second;
-    } else {
-      // TODO : Would std::map avoid allocating a string and then copying?
-      return insert(value_type{key, T()}).first->second;
-    }
+  T& operator[](const Key& key) { return try_emplace(key).first->second; }
+
+  /**
+   * rvalue overload of operator[], the key is moved into the new element.
+   */
+  T& operator[](Key&& key) {
+    return try_emplace(std::move(key)).first->second;
   }
 
   /**
@@ -193,15 +415,53 @@ class skip_map {
    */
   const_iterator cend() const noexcept { return end(); }
 
+  /**
+   * Returns a reverse iterator to the last element, in O(1) through the back
+   * link of end. Only when Bidirectional.
+   */
+  template <bool B = Bidirectional, class = std::enable_if_t<B>>
+  reverse_iterator rbegin() noexcept {
+    return reverse_iterator(end());
+  }
+
+  template <bool B = Bidirectional, class = std::enable_if_t<B>>
+  const_reverse_iterator rbegin() const noexcept {
+    return const_reverse_iterator(end());
+  }
+
+  template <bool B = Bidirectional, class = std::enable_if_t<B>>
+  const_reverse_iterator crbegin() const noexcept {
+    return rbegin();
+  }
+
+  /**
+   * Returns a reverse iterator past the first element. Only when
+   * Bidirectional.
+   */
+  template <bool B = Bidirectional, class = std::enable_if_t<B>>
+  reverse_iterator rend() noexcept {
+    return reverse_iterator(begin());
+  }
+
+  template <bool B = Bidirectional, class = std::enable_if_t<B>>
+  const_reverse_iterator rend() const noexcept {
+    return const_reverse_iterator(begin());
+  }
+
+  template <bool B = Bidirectional, class = std::enable_if_t<B>>
+  const_reverse_iterator crend() const noexcept {
+    return rend();
+  }
+
   /**
    * Checks if the container has no elements
    */
-  bool empty() const noexcept { return begin() == end(); }
+  bool empty() const noexcept { return size_ == 0; }
 
   /**
    * Returns the number of elements in the container
    */
-  size_type size() const noexcept { return std::distance(begin(), end()); }
+  size_type size() const noexcept { return size_; }
 
   /**
    * Returns the maximum number of elements the container is able to hold.
@@ -209,318 +469,1381 @@ class skip_map {
   size_type max_size() const { return std::numeric_limits<size_type>::max(); }
 
   /**
-   * Removes all elements from the container. This particular implementation
-   * does not invalidate past-the-end iterators
+   * Describes the structure of the container: the nodes on each level, the
+   * heights of the towers and the memory they take, in one walk of the bottom
+   * level. The hops are counted over searches for up to samples keys spread
+   * evenly across the container.
    */
-  void clear() noexcept {
-    // If we have a null first pointer it's because the contents were moved out
-    // There is no destruction or dealocating to do
-    if (!rend_) {
-      return;
+  skip_map_stats stats(size_t samples = 64) const {
+    skip_map_stats stats;
+    stats.size = size_;
+    stats.max_level = max_level_;
+    stats.nodes_per_level.resize(max_level_ + 1);
+    stats.height_histogram.resize(max_level_ + 1);
+    stats.average_hops.resize(max_level_ + 1);
+    stats.max_hops.resize(max_level_ + 1);
+
+    using block = typename node_type::block;
+    auto add_memory = [&stats](size_t height) {
+      stats.node_bytes += blocks_for(height) * sizeof(block);
+      stats.link_bytes +=
+          node_type::tower_size(height) + prefix_blocks(height) * sizeof(block);
+    };
+    add_memory(MaxLevel);
+    add_memory(MaxLevel);
+
+    const size_t stride = samples && size_ > samples ? size_ / samples : 1;
+    std::vector<const Key*> sample_keys;
+    size_t index = 0;
+    for (auto node = rend_->link_at(0); node != end_;
+         node = node->link_at(0), ++index) {
+      const size_t height = node->height();
+      ++stats.height_histogram[height - 1];
+      for (size_t level = 0; level < height; ++level) {
+        ++stats.nodes_per_level[level];
+      }
+      add_memory(height);
+
+      if (index % stride == 0 && sample_keys.size() < samples) {
+        sample_keys.push_back(&node->entry.first);
+      }
     }
 
-    // If we have nothing to delete
-    if (empty()) {
-      return;
+    for (auto key : sample_keys) {
+      node_type* node = rend_;
+      for (size_t level = max_level_ + 1; level-- > 0;) {
+        size_t hops = 0;
+        for (auto next = node->link_at(level); is_before(next, *key);
+             next = node->link_at(level)) {
+          node = next;
+          ++hops;
+        }
+        stats.average_hops[level] += hops;
+        stats.max_hops[level] = std::max(stats.max_hops[level], hops);
+      }
+    }
+    stats.sampled_searches = sample_keys.size();
+    if (!sample_keys.empty()) {
+      for (auto& hops : stats.average_hops) {
+        hops /= sample_keys.size();
+      }
     }
 
-    // TODO: Would be faster to just walk and delete. No need to keep the to
-    // levels intact. Remove the nodes one by one until we are left with the end
-    for (auto it = begin(); it != end(); it = erase(it))
-      ;
+    return stats;
   }
 
   /**
-   * Inserts element(s) into the container, if the container doesn't already
-   * contain an element with an equivalent key.
+   * Writes the elements to out in key order, in blocks of about
+   * skip_map_stream::block_bytes encoded with key_codec and value_codec. See
+   * skip_map_stream for the layout. Throws std::runtime_error if out fails.
    */
-  std::pair<iterator, bool> insert(value_type value) {
-    splice_t splice_vec = splice(value.first);
+  template <class KeyCodec = skip_map_codec<Key>,
+            class ValueCodec = skip_map_codec<T>>
+  void save(std::ostream& out,
+            KeyCodec key_codec = KeyCodec(),
+            ValueCodec value_codec = ValueCodec()) const {
+    skip_map_stream::header header{};
+    std::copy(std::begin(skip_map_stream::magic),
+              std::end(skip_map_stream::magic), header.magic);
+    header.format = skip_map_stream::format;
+    header.size = size_;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::string block;
+    block.reserve(skip_map_stream::block_bytes + 64);
+    std::uint32_t count = 0;
+    for (auto node = rend_->link_at(0); node != end_; node = node->link_at(0)) {
+      if (count == 0) {
+        key_codec.reset();
+        value_codec.reset();
+      }
+      key_codec.encode(node->entry.first, block);
+      value_codec.encode(node->entry.second, block);
+      if (++count == std::numeric_limits<std::uint32_t>::max() ||
+          block.size() >= skip_map_stream::block_bytes) {
+        write_block(out, count, block);
+        count = 0;
+      }
+    }
+    if (count) {
+      write_block(out, count, block);
+    }
+    write_block(out, 0, block);
 
-    // Just like lower_bound would do.
-    auto current = splice_vec.back() + 1;
-    if (!key_comparator_(value.first, current->first) && current != end()) {
-      return {current, false};
+    if (!out) {
+      throw std::runtime_error("skip_map::save: write failed");
     }
+  }
 
-    size_t node_level = gen();
+  /**
+   * Replaces the elements with the ones written to in by save() with the same
+   * codecs. in is read one block at a time and the towers are built while
+   * reading, in linear time like the sorted_unique constructor. Throws
+   * std::runtime_error if in fails or does not hold a valid stream, the
+   * container is then left empty.
+   */
+  template <class KeyCodec = skip_map_codec<Key>,
+            class ValueCodec = skip_map_codec<T>>
+  void load(std::istream& in,
+            KeyCodec key_codec = KeyCodec(),
+            ValueCodec value_codec = ValueCodec()) {
+    clear();
+    try {
+      skip_map_stream::header header;
+      read_exactly(in, &header, sizeof(header));
+      if (!std::equal(std::begin(skip_map_stream::magic),
+                      std::end(skip_map_stream::magic), header.magic) ||
+          header.format != skip_map_stream::format) {
+        throw std::runtime_error("skip_map::load: not a skip_map stream");
+      }
 
-    // Handle the case where the new node increase the max level
-    if (node_level > max_level_) {
-      // Add the necessary links to rend_ without touching existing ones.
-      for (size_t i = max_level_ + 1; i <= node_level; ++i) {
-        rend_->set_link(i, end_);
+      auto tail = tail_nodes();
+      std::string block;
+      for (;;) {
+        skip_map_stream::block_header block_header;
+        read_exactly(in, &block_header, sizeof(block_header));
+        if (block_header.count == 0) {
+          break;
+        }
+        block.resize(block_header.bytes);
+        read_exactly(in, &block[0], block.size());
+
+        key_codec.reset();
+        value_codec.reset();
+        const char* position = block.data();
+        const char* block_end = position + block.size();
+        for (std::uint32_t i = 0; i < block_header.count; ++i) {
+          Key key = key_codec.decode(position, block_end);
+          T value = value_codec.decode(position, block_end);
+          if (!appends_after(tail, key)) {
+            throw std::runtime_error("skip_map::load: keys out of order");
+          }
+          const size_t node_level = levels_();
+          raise_max_level(node_level);
+          append_node(tail, allocate_and_init(node_level + 1, std::move(key),
+                                              std::move(value)));
+        }
+        if (position != block_end) {
+          throw std::runtime_error("skip_map::load: corrupted block");
+        }
       }
 
-      // Increase the max level
-      max_level_ = node_level;
+      if (size_ != header.size) {
+        throw std::runtime_error("skip_map::load: truncated stream");
+      }
+      finger_ = tail;
+    } catch (...) {
+      clear();
+      throw;
+    }
+  }
 
-      // We invalidated the lower bounds created earlier. Call the same function
-      // to set them back.
-      splice_vec = splice(value.first);
+  /**
+   * Removes all elements from the container. This particular implementation
+   * does not invalidate past-the-end iterators
+   */
+  void clear() noexcept {
+    // If we have a null first pointer it's because the contents were moved out
+    // There is no destruction or dealocating to do
+    if (!rend_) {
+      return;
     }
 
-    // Create new node
-    auto new_node =
-        allocate_and_init(std::move(value.first), std::move(value.second));
+    // If we have nothing to delete
+    if (empty()) {
+      return;
+    }
 
-    for (auto it : splice_vec) {
-      new_node->set_link(it.level_, (it + 1).get());
-      it.get()->set_link(it.level_, new_node);
+    // There is no need to keep the levels intact while the nodes go away,
+    // reset the tower of rend_ and walk the detached bottom level once. Nodes
+    // are only released once unreachable, the allocator may retire them.
+    auto first = rend_->link_at(0);
+    for (size_t i = 1; i <= max_level_; ++i) {
+      rend_->set_link(i, nullptr);
     }
+    rend_->set_link(0, end_);
+    set_width(rend_, 0, 1);
+    set_prev(end_, rend_);
+    max_level_ = 0;
+    release_range(first, end_);
 
-    return {iterator(new_node), true};
+    size_ = 0;
+    finger_.fill(rend_);
   }
 
   /**
-   *
+   * Inserts element(s) into the container, if the container doesn't already
+   * contain an element with an equivalent key.
    */
-  iterator insert(const_iterator /*hint*/, const value_type& /*value*/) {
-    throw std::runtime_error("Unimplemented!");
+  std::pair<iterator, bool> insert(const value_type& value) {
+    auto preds = predecessors(value.first);
+    return insert_at(preds, value.first, value);
   }
 
   /**
-   *
+   * rvalue overload of insert(), the mapped value is moved into the node.
    */
-  iterator insert(const_iterator /*hint*/, value_type&& /*value*/) {
-    throw std::runtime_error("Unimplemented!");
+  std::pair<iterator, bool> insert(value_type&& value) {
+    auto preds = predecessors(value.first);
+    return insert_at(preds, value.first, std::move(value));
   }
 
   /**
-   *
+   * Inserts an element constructed from value, equivalent to emplace().
    */
-  template <class InputIt>
-  void insert(InputIt /*first*/, InputIt /*last*/) {
-    // TODO : Implement with hint to avoid n*log(n) complexity
-    throw std::runtime_error("Unimplemented!");
+  template <class P,
+            class = std::enable_if_t<std::is_constructible_v<value_type, P&&>>>
+  std::pair<iterator, bool> insert(P&& value) {
+    return emplace(std::forward<P>(value));
   }
 
   /**
+   * Inserts value, hint is ignored. A node only gives its successors, the
+   * predecessors needed to link before hint would take a full search.
    *
+   * Instead of searching from the top of rend_, the search starts from the
+   * finger left by the previous insertion or erasure and only climbs as high
+   * as the distance to the new key requires. Appending in order, or
+   * inserting shortly after the previously inserted key, costs amortized
+   * constant time. Keys before the finger fall back to a regular search,
+   * whatever hint is.
    */
-  void insert(std::initializer_list<value_type> /*ilist*/) {
-    // TODO : Implement with hint to avoid n*log(n) complexity
-    throw std::runtime_error("Unimplemented!");
+  iterator insert(const_iterator /*hint*/, const value_type& value) {
+    auto preds = predecessors_from_finger(value.first);
+    return insert_at(preds, value.first, value).first;
   }
 
   /**
-   *
+   * rvalue overload of the hinted insert()
    */
-  template <class... Args>
-  std::pair<iterator, bool> emplace(Args&&... /*args*/) {
-    throw std::runtime_error("Unimplemented!");
+  iterator insert(const_iterator /*hint*/, value_type&& value) {
+    auto preds = predecessors_from_finger(value.first);
+    return insert_at(preds, value.first, std::move(value)).first;
   }
 
   /**
+   * Inserts the elements of the range [first, last). If multiple elements have
+   * equivalent keys only the first one is inserted.
    *
+   * When the range is sorted and its keys all come after the ones already in
+   * the container the nodes are appended in linear time. Otherwise the range is
+   * copied and sorted first, and only falls back to one insert per element if
+   * its keys are interleaved with the existing ones.
    */
-  template <class... Args>
-  iterator emplace_hint(const_iterator /*hint*/, Args&&... /*args*/) {
-    throw std::runtime_error("Unimplemented!");
-  }
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    if (first == last) {
+      return;
+    }
 
-  /**
-   * Removes specified elements from the container.
-   */
-  iterator erase(iterator pos) {
-    // Don't delete past the end, past the beginning nodes
-    if (pos == iterator(rend_) || pos == end()) {
-      return end();
+    auto tail = tail_nodes();
+
+    // A sorted multi-pass range can be appended without any copy.
+    using category = typename std::iterator_traits<InputIt>::iterator_category;
+    if constexpr (std::is_base_of_v<std::forward_iterator_tag, category>) {
+      auto not_increasing = [this](const auto& lhs, const auto& rhs) {
+        return !key_comparator_(lhs.first, rhs.first);
+      };
+      if (std::adjacent_find(first, last, not_increasing) == last &&
+          appends_after(tail, first->first)) {
+        append_sorted(first, last, tail);
+        return;
+      }
     }
 
-    // Set all previous links to skip the node we are about to delete
-    const auto& splice_vec = splice(pos->first);
-    for (const auto& it : splice_vec) {
-      it.get()->set_link(it.level_, (it + 2).get());
+    std::vector<std::pair<Key, T>> sorted(first, last);
+    auto key_less = [this](const auto& lhs, const auto& rhs) {
+      return key_comparator_(lhs.first, rhs.first);
+    };
+    if (!std::is_sorted(sorted.begin(), sorted.end(), key_less)) {
+      std::stable_sort(sorted.begin(), sorted.end(), key_less);
     }
 
-    destroy_and_release(pos.get());
+    // The sort is stable so keeping the first of equivalent keys behaves like
+    // successive inserts.
+    auto equivalent = [&key_less](const auto& lhs, const auto& rhs) {
+      return !key_less(lhs, rhs) && !key_less(rhs, lhs);
+    };
+    sorted.erase(std::unique(sorted.begin(), sorted.end(), equivalent),
+                 sorted.end());
+
+    if (appends_after(tail, sorted.front().first)) {
+      append_sorted(std::make_move_iterator(sorted.begin()),
+                    std::make_move_iterator(sorted.end()), tail);
+      return;
+    }
 
-    return splice_vec.back() + 1;
+    // The keys are increasing so every search can start from the last one.
+    for (auto& key_value : sorted) {
+      insert(cend(), std::move(key_value));
+    }
   }
 
   /**
-   *
+   * Inserts the elements of ilist, see insert(InputIt, InputIt).
    */
-  void erase(iterator /*first*/, iterator /*last*/) {
-    throw std::runtime_error("Unimplemented!");
+  void insert(std::initializer_list<value_type> ilist) {
+    insert(ilist.begin(), ilist.end());
   }
 
   /**
-   *
+   * Inserts an element constructed in place from args if there is no element
+   * with an equivalent key. Like std::map the node has to be created before the
+   * key is known, it is released if the key is already present. Use
+   * try_emplace() to avoid that.
    */
-  size_type erase(const key_type& key) {
-    auto it = find(key);
-    if (it == end()) {
-      return size();
-    }
-    erase(it);
-
-    return size();
+  template <class... Args>
+  std::pair<iterator, bool> emplace(Args&&... args) {
+    auto new_node =
+        allocate_and_init(levels_() + 1, std::forward<Args>(args)...);
+    auto preds = predecessors(new_node->entry.first);
+    return link_or_release(preds, new_node);
   }
 
   /**
-   *
+   * Inserts an element constructed in place from args, hint is ignored in
+   * favour of the finger, see the hinted insert().
    */
-  void swap(skip_map& other) {
-    std::swap(rend_, other.rend_);
-    std::swap(end_, other.end_);
+  template <class... Args>
+  iterator emplace_hint(const_iterator /*hint*/, Args&&... args) {
+    auto new_node =
+        allocate_and_init(levels_() + 1, std::forward<Args>(args)...);
+    auto preds = predecessors_from_finger(new_node->entry.first);
+    return link_or_release(preds, new_node).first;
   }
 
   /**
-   *
+   * If there is no element with a key equivalent to key, inserts an element
+   * with the key and a mapped value constructed in place from args. Nothing is
+   * allocated or constructed, and args are not moved from, if the key is
+   * already present.
    */
-  size_type count(const Key& key) const {
-    if (find(key) == end()) {
-      return 0;
-    }
-    return 1;
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    auto preds = predecessors(key);
+    return try_emplace_at(preds, key, std::forward<Args>(args)...);
   }
 
   /**
-   * Returns a pair of iterators obtained with lower_bound() and upper_bound()
+   * rvalue overload of try_emplace(), the key is moved into the new element.
    */
-  std::pair<iterator, iterator> equal_range(const Key& key) {
-    return std::make_pair(lower_bound(key), upper_bound(key));
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+    auto preds = predecessors(key);
+    return try_emplace_at(preds, std::move(key), std::forward<Args>(args)...);
   }
 
   /**
-   * const overload of equal_range()
+   * Hinted version of try_emplace(), hint is ignored in favour of the finger,
+   * see the hinted insert().
    */
-  std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
-    return std::make_pair(lower_bound(key), upper_bound(key));
+  template <class... Args>
+  iterator try_emplace(const_iterator /*hint*/,
+                       const key_type& key,
+                       Args&&... args) {
+    auto preds = predecessors_from_finger(key);
+    return try_emplace_at(preds, key, std::forward<Args>(args)...).first;
   }
 
   /**
-   * Returns an iterator pointing to the first element that is not less than
-   * key. Uses casting to avoid duplicated code. Safe since calls of this
-   * function have to come from a non-const object (Effective c++ item 3)
+   * rvalue overload of the hinted try_emplace().
    */
-  iterator lower_bound(const Key& key) {
-    const_iterator it = const_this().lower_bound(key);
-    node_type* ptr = const_cast<node_type*>(it.get());
-    return iterator(ptr);
+  template <class... Args>
+  iterator try_emplace(const_iterator /*hint*/,
+                       key_type&& key,
+                       Args&&... args) {
+    auto preds = predecessors_from_finger(key);
+    return try_emplace_at(preds, std::move(key), std::forward<Args>(args)...)
+        .first;
   }
 
   /**
-   * const overload of lower_bound()
+   * Assigns obj to the mapped value of the element with a key equivalent to
+   * key, or inserts a new element constructed from key and obj if there is
+   * none. The bool is true if an insertion took place.
    */
-  const_iterator lower_bound(const Key& key) const {
-    const auto& splice_vec = splice(key);
-    return splice_vec.back() + 1;
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
+    auto preds = predecessors(key);
+    return insert_or_assign_at(preds, key, std::forward<M>(obj));
   }
 
   /**
-   * Returns an iterator pointing to the first element that is greater than key.
-   * Uses casting to avoid duplicated code. Safe since calls of this function
-   * have to come from a non-const object (Effective c++ item 3)
+   * rvalue overload of insert_or_assign(), the key is moved into the new
+   * element.
    */
-  iterator upper_bound(const Key& key) {
-    const_iterator it = const_this().upper_bound(key);
-    node_type* ptr = const_cast<node_type*>(it.get());
-    return iterator(ptr);
+  template <class M>
+  std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj) {
+    auto preds = predecessors(key);
+    return insert_or_assign_at(preds, std::move(key), std::forward<M>(obj));
   }
 
   /**
-   * const overload of upper_bound()
+   * Removes specified elements from the container. Returns the iterator
+   * following the removed element.
    */
-  const_iterator upper_bound(const Key& key) const {
-    auto it = lower_bound(key);
-
-    if (it == end()) {
-      return it;
+  iterator erase(iterator pos) {
+    // Don't delete past the end, past the beginning nodes
+    if (pos == iterator(rend_) || pos == end()) {
+      return end();
     }
 
-    return it + 1;
+    return erase(pos, std::next(pos));
   }
 
   /**
-   *
+   * Removes the elements in the range [first, last). The predecessors of first
+   * are found once, from the finger when possible, and are linked to the
+   * nodes following the range on every level before the nodes are released.
+   * The cost is O(log n + k) for k removed elements, erasing
+   * successive elements with it = erase(it) does not search at all.
    */
-  Allocator get_allocator() const { return allocator_; }
+  iterator erase(const_iterator first, const_iterator last) {
+    auto first_node = const_cast<node_type*>(first.get());
+    auto last_node = const_cast<node_type*>(last.get());
+    if (first_node == last_node) {
+      return iterator(last_node);
+    }
 
-  void set_gen_for_testing(std::function<int()> func) { gen = func; }
+    auto preds = predecessors_from_finger(first_node->entry.first);
+    return erase_between(preds, last_node);
+  }
 
- private:
   /**
-   * Return lower bound of each level by key.
+   * Removes the element with a key equivalent to key, if any. Returns the
+   * number of elements removed, 0 or 1.
    */
-  splice_t splice(const Key& key) {
-    // First get the const_iterators by invoking the const version of splice
-    const const_splice_t& const_lower_bounds = const_this().splice(key);
-
-    // Convert const iterators into iterators
-    splice_t lower_bounds;
-    for (const auto& const_bound : const_lower_bounds) {
-      lower_bounds.emplace_back(const_cast<node_type*>(const_bound.get()),
-                                const_bound.level_);
+  size_type erase(const key_type& key) {
+    auto preds = predecessors(key);
+    auto node = find_at(preds, key);
+    if (!node) {
+      return 0;
     }
+    erase_between(preds, node->link_at(0));
 
-    return lower_bounds;
+    return 1;
   }
 
   /**
-   * const overload of splice()
+   * Finds the elements with keys equivalent to the keys of the sorted range
+   * [first, last) and writes an iterator to each of them, or end(), to out.
+   *
+   * Each search starts from the predecessors of the previous key and only
+   * climbs as high as the distance between the two keys requires, k sorted
+   * keys cost O(k log(n/k)) instead of O(k log n). Unsorted keys are still
+   * found but a key before the previous one searches from the top.
    */
-  const_splice_t splice(const Key& key) const {
-    const_splice_t lower_bounds;
-
-    // Start at the top level and go down every level to the fist non terminal
-    // node on the level.
-    const_iterator start(rend_, max_level_);
-    for (size_t i = 0; i <= max_level_; ++i) {
-      auto temp = start;
-
-      const_iterator it;
-      // Advance as far as we can without reaching the end or going over
-      while ((it = temp + 1) != end() && key_comparator_((it)->first, key)) {
-        ++temp;
-      }
-
-      lower_bounds.push_back(temp);
-
-      // The seach will start again from the last found node at the next level.
-      start = temp;
-      start.go_down();
+  template <class InputIt, class OutputIt>
+  OutputIt find_batch(InputIt first, InputIt last, OutputIt out) {
+    level_nodes_t finger;
+    finger.fill(rend_);
+    for (; first != last; ++first) {
+      *out++ = iterator(find_from(finger, *first));
     }
-
-    return lower_bounds;
+    return out;
   }
 
   /**
-   * Convenience function to allocate and initialize memory in the same call
+   * const overload of find_batch()
    */
-  template <typename... Args>
-  node_type* allocate_and_init(Args&&... arguments) {
-    auto ptr(allocator_.allocate(sizeof(node_type)));
-    allocator_.construct(ptr, std::forward<Args>(arguments)...);
-    return ptr;
+  template <class InputIt, class OutputIt>
+  OutputIt find_batch(InputIt first, InputIt last, OutputIt out) const {
+    level_nodes_t finger;
+    finger.fill(rend_);
+    for (; first != last; ++first) {
+      *out++ = const_iterator(find_from(finger, *first));
+    }
+    return out;
   }
 
   /**
-   * Convenience function to destroy a node object and deallocate in the same
-   * call.
+   * Finds the elements with keys equivalent to the keys of [first, last), in
+   * any order, and writes an iterator to each of them, or end(), at the same
+   * position from out.
+   *
+   * Up to Lanes searches run interleaved: each one moves by a single hop
+   * before the next one gets its turn, and the node it will look at next is
+   * prefetched. While a search waits on a cache miss the other ones go on, so
+   * on maps larger than the cache Lanes misses are in flight at once instead
+   * of one.
    */
-  void destroy_and_release(node_type* ptr) {
-    if (ptr) {
-      allocator_.destroy(ptr);
-      allocator_.deallocate(ptr, sizeof(node_type));
-    }
+  template <size_t Lanes = 8, class ForwardIt, class RandomIt>
+  RandomIt find_interleaved(ForwardIt first, ForwardIt last, RandomIt out) {
+    return out + interleaved_lookup<Lanes>(
+                     first, last, [&out](size_t index, node_type* node) {
+                       out[index] = iterator(node);
+                     });
   }
 
   /**
-   * Private instance of the Allocator type used to allocate and initialize
-   * nodes
+   * const overload of find_interleaved()
    */
-  Allocator allocator_;
+  template <size_t Lanes = 8, class ForwardIt, class RandomIt>
+  RandomIt find_interleaved(ForwardIt first,
+                            ForwardIt last,
+                            RandomIt out) const {
+    return out + interleaved_lookup<Lanes>(
+                     first, last, [&out](size_t index, node_type* node) {
+                       out[index] = const_iterator(node);
+                     });
+  }
 
   /**
-   * Pointer to the element preceding the first element.
+   * Inserts the elements of the range [first, last), sorted by key, that have
+   * no equivalent key in the container. Like find_batch() each insertion
+   * starts from the position of the previous one. Returns the number of
+   * elements inserted.
    */
-  node_type* rend_;
+  template <class InputIt>
+  size_type insert_batch(InputIt first, InputIt last) {
+    size_type inserted = 0;
+    for (; first != last; ++first) {
+      auto preds = predecessors_from_finger(first->first);
+      inserted += insert_at(preds, first->first, *first).second;
+    }
+    return inserted;
+  }
 
   /**
-   * Pointer to the element following the last element.
+   * Removes the elements with keys equivalent to the keys of the sorted range
+   * [first, last). Like find_batch() each search starts from the position of
+   * the previous one. Returns the number of elements removed.
+   */
+  template <class InputIt>
+  size_type erase_batch(InputIt first, InputIt last) {
+    size_type erased = 0;
+    for (; first != last; ++first) {
+      auto preds = predecessors_from_finger(*first);
+      if (auto node = find_at(preds, *first)) {
+        erase_between(preds, node->link_at(0));
+        ++erased;
+      }
+    }
+    return erased;
+  }
+
+  /**
+   * Exchanges the contents of the container with those of other.
+   */
+  void swap(skip_map& other) {
+    std::swap(allocator_, other.allocator_);
+    std::swap(rend_, other.rend_);
+    std::swap(end_, other.end_);
+    std::swap(max_level_, other.max_level_);
+    std::swap(size_, other.size_);
+    std::swap(finger_, other.finger_);
+    std::swap(key_comparator_, other.key_comparator_);
+    std::swap(levels_, other.levels_);
+  }
+
+  /**
+   * Returns the number of elements with a key equivalent to key, 0 or 1.
+   */
+  size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+  /**
+   * Transparent overload of count()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  size_type count(const K& key) const {
+    return contains(key) ? 1 : 0;
+  }
+
+  /**
+   * Checks if there is an element with a key equivalent to key.
+   */
+  bool contains(const Key& key) const { return find_node(key) != end_; }
+
+  /**
+   * Transparent overload of contains()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  bool contains(const K& key) const {
+    return find_node(key) != end_;
+  }
+
+  /**
+   * Returns a pair of iterators obtained with lower_bound() and upper_bound()
+   */
+  std::pair<iterator, iterator> equal_range(const Key& key) {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  /**
+   * const overload of equal_range()
+   */
+  std::pair<const_iterator, const_iterator> equal_range(const Key& key) const {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  /**
+   * Transparent overload of equal_range()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  std::pair<iterator, iterator> equal_range(const K& key) {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  /**
+   * const overload of the transparent equal_range()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+    return std::make_pair(lower_bound(key), upper_bound(key));
+  }
+
+  /**
+   * Returns an iterator pointing to the first element that is not less than
+   * key. Uses casting to avoid duplicated code. Safe since calls of this
+   * function have to come from a non-const object (Effective c++ item 3)
+   */
+  iterator lower_bound(const Key& key) {
+    const_iterator it = const_this().lower_bound(key);
+    node_type* ptr = const_cast<node_type*>(it.get());
+    return iterator(ptr);
+  }
+
+  /**
+   * const overload of lower_bound()
+   */
+  const_iterator lower_bound(const Key& key) const {
+    return const_iterator(lower_bound_node(key));
+  }
+
+  /**
+   * Transparent overload of lower_bound()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  iterator lower_bound(const K& key) {
+    return iterator(lower_bound_node(key));
+  }
+
+  /**
+   * const overload of the transparent lower_bound()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  const_iterator lower_bound(const K& key) const {
+    return const_iterator(lower_bound_node(key));
+  }
+
+  /**
+   * Returns an iterator pointing to the first element that is greater than key.
+   * Uses casting to avoid duplicated code. Safe since calls of this function
+   * have to come from a non-const object (Effective c++ item 3)
+   */
+  iterator upper_bound(const Key& key) {
+    const_iterator it = const_this().upper_bound(key);
+    node_type* ptr = const_cast<node_type*>(it.get());
+    return iterator(ptr);
+  }
+
+  /**
+   * const overload of upper_bound()
+   */
+  const_iterator upper_bound(const Key& key) const {
+    return const_iterator(upper_bound_node(key));
+  }
+
+  /**
+   * Transparent overload of upper_bound()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  iterator upper_bound(const K& key) {
+    return iterator(upper_bound_node(key));
+  }
+
+  /**
+   * const overload of the transparent upper_bound()
+   */
+  template <class K, class C = Compare, class = typename C::is_transparent>
+  const_iterator upper_bound(const K& key) const {
+    return const_iterator(upper_bound_node(key));
+  }
+
+  /**
+   * Returns an iterator to the element at index i in key order, or end() if
+   * there are not that many elements. O(log n), only when Indexed.
+   */
+  template <bool I = Indexed, class = std::enable_if_t<I>>
+  iterator nth(size_type i) {
+    return iterator(nth_node(i));
+  }
+
+  /**
+   * const overload of nth()
+   */
+  template <bool I = Indexed, class = std::enable_if_t<I>>
+  const_iterator nth(size_type i) const {
+    return const_iterator(nth_node(i));
+  }
+
+  /**
+   * Returns the number of elements ordered before key, the index of
+   * lower_bound(key). O(log n), only when Indexed.
+   */
+  template <bool I = Indexed, class = std::enable_if_t<I>>
+  size_type rank(const Key& key) const {
+    return rank_of(key);
+  }
+
+  /**
+   * Transparent overload of rank()
+   */
+  template <class K,
+            class C = Compare,
+            class = typename C::is_transparent,
+            bool I = Indexed,
+            class = std::enable_if_t<I>>
+  size_type rank(const K& key) const {
+    return rank_of(key);
+  }
+
+  /**
+   * Returns the number of elements from first to last, which have to be
+   * iterators of this container. O(log n) instead of the linear walk of
+   * std::distance(), only when Indexed.
+   */
+  template <bool I = Indexed, class = std::enable_if_t<I>>
+  difference_type distance(const_iterator first, const_iterator last) const {
+    auto index = [this](const_iterator it) {
+      return it == end() ? size_ : rank_of(it->first);
+    };
+    return static_cast<difference_type>(index(last)) -
+           static_cast<difference_type>(index(first));
+  }
+
+  /**
+   *
+   */
+  Allocator get_allocator() const { return Allocator(allocator_); }
+
+  void set_level_generator_for_testing(LevelGenerator levels) {
+    levels_ = std::move(levels);
+  }
+
+ private:
+  /**
+   * Destroys and releases every node between rend_ and end_ by walking the
+   * bottom level once. The links of rend_ are left dangling.
+   */
+  void release_nodes() noexcept { release_range(rend_->link_at(0), end_); }
+
+  /**
+   * Destroys and releases the nodes of the bottom level from first up to
+   * last excluded.
+   */
+  void release_range(node_type* first, node_type* last) noexcept {
+    while (first != last) {
+      auto next = first->link_at(0);
+      destroy_and_release(first);
+      first = next;
+    }
+  }
+
+  /**
+   * Return the last node before key of each level, indexed by level. Levels
+   * above max_level_ are filled with rend_.
+   */
+  template <class K>
+  level_nodes_t predecessors(const K& key) const {
+    level_nodes_t preds;
+    preds.fill(rend_);
+
+    node_type* node = rend_;
+    for (size_t level = max_level_ + 1; level-- > 0;) {
+      preds[level] = advance(node, level, key);
+    }
+
+    return preds;
+  }
+
+  /**
+   * Same as predecessors() but the search starts from finger_ when it is
+   * before key. The search first climbs the levels of the finger until the
+   * next node is not before key anymore and then goes down like a regular
+   * search. Upper levels keep the nodes of the finger.
+   */
+  level_nodes_t predecessors_from_finger(const Key& key) const {
+    return predecessors_from(finger_, key);
+  }
+
+  /**
+   * predecessors_from_finger() starting from any finger, such as the
+   * predecessors of the previous key of a batch.
+   */
+  level_nodes_t predecessors_from(const level_nodes_t& finger,
+                                  const Key& key) const {
+    if (finger[0] != rend_ && !key_comparator_(finger[0]->entry.first, key)) {
+      return predecessors(key);
+    }
+
+    level_nodes_t preds = finger;
+
+    size_t top = 0;
+    while (top < max_level_ && is_before(finger[top]->link_at(top), key)) {
+      ++top;
+    }
+
+    node_type* node = finger[top];
+    for (size_t level = top + 1; level-- > 0;) {
+      preds[level] = advance(node, level, key);
+    }
+
+    return preds;
+  }
+
+  /**
+   * Moves node forward on level as long as the next node is before key.
+   * Returns the last node before key.
+   */
+  template <class K>
+  node_type* advance(node_type*& node, size_t level, const K& key) const {
+    for (auto next = node->link_at(level); is_before(next, key);
+         next = node->link_at(level)) {
+      node = next;
+    }
+    return node;
+  }
+
+  /**
+   * Whether node holds an element ordered before key.
+   */
+  template <class K>
+  bool is_before(const node_type* node, const K& key) const {
+    return node != end_ && key_comparator_(node->entry.first, key);
+  }
+
+  /**
+   * Returns the first node not before key, or end_.
+   */
+  template <class K>
+  node_type* lower_bound_node(const K& key) const {
+    return predecessors(key)[0]->link_at(0);
+  }
+
+  /**
+   * Returns the node holding a key equivalent to key, or end_.
+   */
+  template <class K>
+  node_type* find_node(const K& key) const {
+    auto node = lower_bound_node(key);
+    if (node != end_ && !key_comparator_(key, node->entry.first)) {
+      return node;
+    }
+    return end_;
+  }
+
+  /**
+   * Returns the node at index i, or end_, by summing the widths of the links
+   * followed from the top.
+   */
+  node_type* nth_node(size_type i) const {
+    if (i >= size_) {
+      return end_;
+    }
+
+    // rend_ is at position 0 and the element at index i at position i + 1.
+    node_type* node = rend_;
+    size_t position = 0;
+    for (size_t level = max_level_ + 1; level-- > 0;) {
+      while (position + width(node, level) <= i + 1) {
+        position += width(node, level);
+        node = node->link_at(level);
+      }
+    }
+    return node;
+  }
+
+  /**
+   * Number of elements before key, the position of its predecessor on the
+   * bottom level.
+   */
+  template <class K>
+  size_type rank_of(const K& key) const {
+    node_type* node = rend_;
+    size_t position = 0;
+    for (size_t level = max_level_ + 1; level-- > 0;) {
+      for (auto next = node->link_at(level); is_before(next, key);
+           next = node->link_at(level)) {
+        position += width(node, level);
+        node = next;
+      }
+    }
+    return position;
+  }
+
+  /**
+   * Returns the first node after key, or end_.
+   */
+  template <class K>
+  node_type* upper_bound_node(const K& key) const {
+    auto node = lower_bound_node(key);
+    if (node != end_ && !key_comparator_(key, node->entry.first)) {
+      return node->link_at(0);
+    }
+    return node;
+  }
+
+  /**
+   * Runs the searches of find_interleaved() and calls found with the position
+   * of each key in [first, last) and its node, or end_. Returns the number of
+   * keys.
+   */
+  template <size_t Lanes, class ForwardIt, class F>
+  size_t interleaved_lookup(ForwardIt first, ForwardIt last, F found) const {
+    static_assert(Lanes > 0, "At least one search has to run");
+
+    struct lane {
+      const Key* key;
+      node_type* node;
+      size_t level;
+      size_t index;
+    };
+    std::array<lane, Lanes> lanes;
+    size_t active = 0;
+    size_t started = 0;
+
+    auto start = [&](lane& l) {
+      l = lane{&*first, rend_, max_level_, started++};
+      ++first;
+    };
+    for (; active < Lanes && first != last; ++active) {
+      start(lanes[active]);
+    }
+
+    while (active > 0) {
+      for (size_t i = 0; i < active;) {
+        lane& l = lanes[i];
+        auto next = l.node->link_at(l.level);
+        if (is_before(next, *l.key)) {
+          l.node = next;
+        } else if (l.level > 0) {
+          --l.level;
+        } else {
+          const bool equal =
+              next != end_ && !key_comparator_(*l.key, next->entry.first);
+          found(l.index, equal ? next : end_);
+
+          // Reuse the lane for the next key, or give it to the last one.
+          if (first != last) {
+            start(l);
+          } else {
+            l = lanes[--active];
+            continue;
+          }
+        }
+
+        prefetch(l.node->link_at(l.level));
+        ++i;
+      }
+    }
+
+    return started;
+  }
+
+  /**
+   * Asks for the cache line holding the links and key of node to be loaded.
+   */
+  static void prefetch(const node_type* node) {
+#if defined(__GNUC__)
+    __builtin_prefetch(node);
+#else
+    (void)node;
+#endif
+  }
+
+  /**
+   * Moves finger to the predecessors of key and returns the node holding key,
+   * or end_. finger_ is left untouched.
+   */
+  node_type* find_from(level_nodes_t& finger, const Key& key) const {
+    finger = predecessors_from(finger, key);
+    auto next = finger[0]->link_at(0);
+    if (next != end_ && !key_comparator_(key, next->entry.first)) {
+      return next;
+    }
+    return end_;
+  }
+
+  /**
+   * Returns the node following preds, the predecessors of key, if it holds an
+   * equivalent key. The finger is left on preds.
+   */
+  node_type* find_at(const level_nodes_t& preds, const Key& key) {
+    finger_ = preds;
+
+    // Just like lower_bound would do.
+    auto current = preds[0]->link_at(0);
+    if (!key_comparator_(key, current->entry.first) && current != end_) {
+      return current;
+    }
+    return nullptr;
+  }
+
+  /**
+   * Inserts a node constructed from arguments after preds, the predecessors of
+   * key, unless the next node already holds an equivalent key. Nothing is
+   * allocated in that case. The finger is left on the inserted, or found,
+   * position.
+   */
+  template <class... Args>
+  std::pair<iterator, bool> insert_at(level_nodes_t& preds,
+                                      const Key& key,
+                                      Args&&... arguments) {
+    if (auto current = find_at(preds, key)) {
+      return {iterator(current), false};
+    }
+
+    auto new_node =
+        allocate_and_init(levels_() + 1, std::forward<Args>(arguments)...);
+    link_node(preds, new_node);
+    return {iterator(new_node), true};
+  }
+
+  /**
+   * insert_at() with the mapped value constructed in place from args.
+   */
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_at(level_nodes_t& preds,
+                                           K&& key,
+                                           Args&&... args) {
+    const Key& key_ref = key;
+    return insert_at(preds, key_ref, std::piecewise_construct,
+                     std::forward_as_tuple(std::forward<K>(key)),
+                     std::forward_as_tuple(std::forward<Args>(args)...));
+  }
+
+  /**
+   * Assigns obj to the node following preds if it holds key, otherwise inserts
+   * a new node constructed from key and obj.
+   */
+  template <class K, class M>
+  std::pair<iterator, bool> insert_or_assign_at(level_nodes_t& preds,
+                                                K&& key,
+                                                M&& obj) {
+    if (auto current = find_at(preds, key)) {
+      current->entry.second = std::forward<M>(obj);
+      return {iterator(current), false};
+    }
+
+    return try_emplace_at(preds, std::forward<K>(key), std::forward<M>(obj));
+  }
+
+  /**
+   * Removes the nodes between preds, the predecessors of the first node to
+   * remove, and last. Returns an iterator to last. The finger is left on
+   * preds which is the position right before last once the nodes are gone.
+   */
+  iterator erase_between(level_nodes_t& preds, node_type* last) {
+    // The last removed node of each level links to the node that has to
+    // follow preds on that level. Levels without any removed node keep their
+    // current link.
+    level_nodes_t next;
+    for (size_t i = 0; i <= max_level_; ++i) {
+      next[i] = preds[i]->link_at(i);
+    }
+
+    // The links of preds take over the widths of the removed links on their
+    // level, less one per removed node.
+    std::array<size_t, MaxLevel> widths{};
+    size_t removed = 0;
+
+    auto first = preds[0]->link_at(0);
+    for (auto node = first; node != last; node = node->link_at(0)) {
+      for (size_t i = 0; i < node->height(); ++i) {
+        next[i] = node->link_at(i);
+        if constexpr (Indexed) {
+          widths[i] += width(node, i);
+        }
+      }
+      ++removed;
+    }
+
+    for (size_t i = 0; i <= max_level_; ++i) {
+      preds[i]->set_link(i, next[i]);
+      if constexpr (Indexed) {
+        width(preds[i], i) += widths[i] - removed;
+      }
+    }
+    set_prev(last, preds[0]);
+    size_ -= removed;
+
+    // The nodes are unreachable now, the allocator may retire them.
+    release_range(first, last);
+
+    finger_ = preds;
+    return iterator(last);
+  }
+
+  /**
+   * Links an already constructed node after preds, the predecessors of its
+   * key, unless the next node holds an equivalent key in which case the new
+   * node is released.
+   */
+  std::pair<iterator, bool> link_or_release(level_nodes_t& preds,
+                                            node_type* new_node) {
+    if (auto current = find_at(preds, new_node->entry.first)) {
+      destroy_and_release(new_node);
+      return {iterator(current), false};
+    }
+
+    link_node(preds, new_node);
+    return {iterator(new_node), true};
+  }
+
+  /**
+   * Links new_node after preds on every level of its tower and leaves the
+   * finger on it.
+   */
+  void link_node(level_nodes_t& preds, node_type* new_node) {
+    // Handle the case where the new node increase the max level. The new
+    // levels are empty and preds already holds rend_ for them.
+    raise_max_level(new_node->height() - 1);
+
+    if constexpr (Indexed) {
+      // The links of preds get split in two around the new node, the links
+      // above its tower skip one more element.
+      auto offsets = offsets_from_bottom(preds, new_node->height());
+      for (size_t i = 0; i < new_node->height(); ++i) {
+        set_width(new_node, i, width(preds[i], i) - offsets[i]);
+        set_width(preds[i], i, offsets[i] + 1);
+      }
+      for (size_t i = new_node->height(); i <= max_level_; ++i) {
+        ++width(preds[i], i);
+      }
+    }
+
+    set_prev(new_node, preds[0]);
+    set_prev(preds[0]->link_at(0), new_node);
+
+    // Only the levels covered by the tower of the new node are linked.
+    for (size_t i = 0; i < new_node->height(); ++i) {
+      new_node->set_link(i, preds[i]->link_at(i));
+      preds[i]->set_link(i, new_node);
+      preds[i] = new_node;
+    }
+    ++size_;
+
+    finger_ = preds;
+  }
+
+  /**
+   * Return the last node of each level, indexed by level. Levels above
+   * max_level_ are filled with rend_.
+   */
+  level_nodes_t tail_nodes() {
+    level_nodes_t tail;
+    tail.fill(rend_);
+
+    node_type* node = rend_;
+    for (size_t level = max_level_ + 1; level-- > 0;) {
+      while (node->link_at(level) != end_) {
+        node = node->link_at(level);
+      }
+      tail[level] = node;
+    }
+
+    return tail;
+  }
+
+  static void write_block(std::ostream& out,
+                          std::uint32_t count,
+                          std::string& block) {
+    const skip_map_stream::block_header header{
+        count, static_cast<std::uint32_t>(block.size())};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(block.data(), block.size());
+    block.clear();
+  }
+
+  static void read_exactly(std::istream& in, void* buffer, size_t bytes) {
+    if (!in.read(static_cast<char*>(buffer), bytes)) {
+      throw std::runtime_error("skip_map::load: truncated stream");
+    }
+  }
+
+  /**
+   * Whether key can be appended after the nodes of tail.
+   */
+  bool appends_after(const level_nodes_t& tail,
+                     const Key& key) const {
+    return tail[0] == rend_ || key_comparator_(tail[0]->entry.first, key);
+  }
+
+  /**
+   * Appends the elements of [first, last) after the nodes of tail, in a single
+   * left to right pass. The range has to be sorted by Compare, without
+   * equivalent keys and after the current content of the container.
+   */
+  template <class InputIt>
+  void append_sorted(InputIt first,
+                     InputIt last,
+                     level_nodes_t tail) {
+    for (; first != last; ++first) {
+      size_t node_level = levels_();
+
+      // New levels start right after rend_ which is already in tail.
+      raise_max_level(node_level);
+
+      auto&& key_value = *first;
+      using source_reference = decltype(key_value);
+      append_node(tail, allocate_and_init(
+                            node_level + 1,
+                            std::forward<source_reference>(key_value).first,
+                            std::forward<source_reference>(key_value).second));
+    }
+    finger_ = tail;
+  }
+
+  /**
+   * Links new_node at the end of every level it covers and makes it the new
+   * tail of those levels.
+   */
+  void append_node(level_nodes_t& tail,
+                   node_type* new_node) {
+    set_prev(new_node, tail[0]);
+    set_prev(end_, new_node);
+    for (size_t i = 0; i < new_node->height(); ++i) {
+      new_node->set_link(i, end_);
+      tail[i]->set_link(i, new_node);
+      tail[i] = new_node;
+      // The node takes the place of end_, the width of tail holds.
+      set_width(new_node, i, 1);
+    }
+    if constexpr (Indexed) {
+      for (size_t i = new_node->height(); i <= max_level_; ++i) {
+        ++width(tail[i], i);
+      }
+    }
+    ++size_;
+  }
+
+  /**
+   * Makes sure max_level_ is at least level. Added levels are empty, rend_
+   * directly links to end_ on them.
+   */
+  void raise_max_level(size_t level) {
+    // Add the necessary links to rend_ without touching existing ones.
+    for (size_t i = max_level_ + 1; i <= level; ++i) {
+      rend_->set_link(i, end_);
+      set_width(rend_, i, size_ + 1);
+    }
+    max_level_ = std::max(max_level_, level);
+  }
+
+  /**
+   * Blocks in front of the tower of links of the given height, for the back
+   * link if Bidirectional and the widths if Indexed:
+   *
+   *   [padding][width h-1]...[width 0][prev][padding][link h-1]...[link 0]
+   */
+  static constexpr size_t prefix_blocks(size_t height) {
+    using block = typename node_type::block;
+    const size_t bytes = (Bidirectional ? sizeof(node_type*) : 0) +
+                         (Indexed ? height * sizeof(size_t) : 0);
+    return (bytes + sizeof(block) - 1) / sizeof(block);
+  }
+
+  /**
+   * Blocks allocated for a node of the given height, prefix included.
+   */
+  static constexpr size_t blocks_for(size_t height) {
+    return prefix_blocks(height) + node_type::blocks_for(height);
+  }
+
+  /**
+   * Number of elements the link of node on level skips on the bottom level,
+   * the distance between node and node->link_at(level).
+   */
+  static size_t& width(node_type* node, size_t level) {
+    auto widths_end = static_cast<unsigned char*>(node->storage()) -
+                      (Bidirectional ? sizeof(node_type*) : 0);
+    return *(reinterpret_cast<size_t*>(widths_end) - 1 - level);
+  }
+
+  static void set_prev(node_type* node, node_type* prev) {
+    if constexpr (Bidirectional) {
+      node->set_prev(prev);
+    }
+  }
+
+  static void set_width(node_type* node, size_t level, size_t value) {
+    if constexpr (Indexed) {
+      width(node, level) = value;
+    }
+  }
+
+  /**
+   * Distance on the bottom level from preds[i] to preds[0] for the levels
+   * below height. preds[i - 1] is reached from preds[i] on level i - 1.
+   */
+  std::array<size_t, MaxLevel> offsets_from_bottom(const level_nodes_t& preds,
+                                                   size_t height) const {
+    std::array<size_t, MaxLevel> offsets{};
+    for (size_t i = 1; i < height; ++i) {
+      offsets[i] = offsets[i - 1];
+      for (auto node = preds[i]; node != preds[i - 1];
+           node = node->link_at(i - 1)) {
+        offsets[i] += width(node, i - 1);
+      }
+    }
+    return offsets;
+  }
+
+  /**
+   * Convenience function to allocate and initialize memory in the same call.
+   * The node and its tower of height links are placed in one allocation.
+   */
+  template <typename... Args>
+  node_type* allocate_and_init(size_t height, Args&&... arguments) {
+    using traits = std::allocator_traits<node_allocator_type>;
+    const size_t blocks = blocks_for(height);
+    auto storage = traits::allocate(allocator_, blocks);
+    try {
+      auto node = node_type::create(storage + prefix_blocks(height), height,
+                                    std::forward<Args>(arguments)...);
+      set_prev(node, nullptr);
+      return node;
+    } catch (...) {
+      traits::deallocate(allocator_, storage, blocks);
+      throw;
+    }
+  }
+
+  /**
+   * Convenience function to destroy a node object and deallocate in the same
+   * call. Allocators with a retire() member are handed the node instead.
+   */
+  void destroy_and_release(node_type* ptr) {
+    if constexpr (has_retire<node_allocator_type, node_type>::value) {
+      if (ptr) {
+        allocator_.retire(ptr);
+      }
+    } else if (ptr) {
+      using traits = std::allocator_traits<node_allocator_type>;
+      const size_t height = ptr->height();
+      auto storage = node_type::destroy(ptr);
+      traits::deallocate(
+          allocator_,
+          static_cast<typename node_type::block*>(storage) -
+              prefix_blocks(height),
+          blocks_for(height));
+    }
+  }
+
+  /**
+   * Private instance of the Allocator type, rebound to blocks, used to
+   * allocate nodes
+   */
+  node_allocator_type allocator_;
+
+  /**
+   * Pointer to the element preceding the first element.
+   */
+  node_type* rend_;
+
+  /**
+   * Pointer to the element following the last element.
    */
   node_type* end_;
 
@@ -529,26 +1852,49 @@ class skip_map {
    */
   size_type max_level_;
 
+  /**
+   * The number of elements in the container, maintained by every operation
+   * adding or removing nodes so size() does not have to walk the list.
+   */
+  size_type size_;
+
+  /**
+   * The last node of each level at or before the position of the last
+   * insertion. Hinted insertions start their search from there. Every
+   * operation changing the list keeps it on a valid position.
+   */
+  level_nodes_t finger_;
+
   /**
    * Instance of Compare used to compare keys
    */
   key_compare key_comparator_;
 
   /**
-   * Random number generator that determins the level of an inserted node
+   * Draws the level of an inserted node
    */
-  Distribution dist;
-  std::function<int()> gen = [this]() { return dist.get_value(); };
+  LevelGenerator levels_;
 
   // Define friend classes only for unit testing purposes
   friend class ConstructedTest;
   FRIEND_TEST(ConstructedTest, iterate);
-  FRIEND_TEST(ConstructedTest, splice);
 
   FRIEND_TEST(insert, increasing_levels);
 
   FRIEND_TEST(compare_count, none);
   FRIEND_TEST(compare_count, case1);
+  FRIEND_TEST(compare_count, clear);
+
+  FRIEND_TEST(levels, grow_with_size);
+  FRIEND_TEST(stats, structure);
+
+  FRIEND_TEST(copying, preserves_structure);
+  FRIEND_TEST(copying, carries_comparator);
+
+  FRIEND_TEST(insert, hint_in_order);
+
+  FRIEND_TEST(erase, successive);
+  FRIEND_TEST(batch, fewer_comparisons);
 };
 
 /**
@@ -556,9 +1902,19 @@ class skip_map {
  * == rhs.size() and each element in lhs compares equal with the element in rhs
  * at the same position.
  */
-template <class Key, class T, class Compare, class Alloc>
-bool operator==(const skip_map<Key, T, Compare, Alloc>& lhs,
-                const skip_map<Key, T, Compare, Alloc>& rhs) {
+template <class Key,
+          class T,
+          class Compare,
+          class Alloc,
+          size_t MaxLevel,
+          class Probability,
+          class Levels,
+          bool Indexed,
+          bool Bidirectional>
+bool operator==(const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& lhs,
+                const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& rhs) {
   if (lhs.size() != rhs.size()) {
     return false;
   }
@@ -577,56 +1933,150 @@ bool operator==(const skip_map<Key, T, Compare, Alloc>& lhs,
 /**
  * Verifies that lhs and rhs are not equal. Uses the operartor ==
  */
-template <class Key, class T, class Compare, class Alloc>
-bool operator!=(const skip_map<Key, T, Compare, Alloc>& lhs,
-                const skip_map<Key, T, Compare, Alloc>& rhs) {
+template <class Key,
+          class T,
+          class Compare,
+          class Alloc,
+          size_t MaxLevel,
+          class Probability,
+          class Levels,
+          bool Indexed,
+          bool Bidirectional>
+bool operator!=(const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& lhs,
+                const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& rhs) {
   return !(lhs == rhs);
 }
 
 /**
  *
  */
-template <class Key, class T, class Compare, class Alloc>
-bool operator<(const skip_map<Key, T, Compare, Alloc>& /*lhs*/,
-               const skip_map<Key, T, Compare, Alloc>& /*rhs*/) {
+template <class Key,
+          class T,
+          class Compare,
+          class Alloc,
+          size_t MaxLevel,
+          class Probability,
+          class Levels,
+          bool Indexed,
+          bool Bidirectional>
+bool operator<(const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                              Levels, Indexed, Bidirectional>& /*lhs*/,
+               const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                              Levels, Indexed, Bidirectional>& /*rhs*/) {
   throw std::runtime_error("Unimplemented!");
 }
 
 /**
  *
  */
-template <class Key, class T, class Compare, class Alloc>
-bool operator<=(const skip_map<Key, T, Compare, Alloc>& /*lhs*/,
-                const skip_map<Key, T, Compare, Alloc>& /*rhs*/) {
+template <class Key,
+          class T,
+          class Compare,
+          class Alloc,
+          size_t MaxLevel,
+          class Probability,
+          class Levels,
+          bool Indexed,
+          bool Bidirectional>
+bool operator<=(const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& /*lhs*/,
+                const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& /*rhs*/) {
   throw std::runtime_error("Unimplemented!");
 }
 
 /**
  *
  */
-template <class Key, class T, class Compare, class Alloc>
-bool operator>(const skip_map<Key, T, Compare, Alloc>& /*lhs*/,
-               const skip_map<Key, T, Compare, Alloc>& /*rhs*/) {
+template <class Key,
+          class T,
+          class Compare,
+          class Alloc,
+          size_t MaxLevel,
+          class Probability,
+          class Levels,
+          bool Indexed,
+          bool Bidirectional>
+bool operator>(const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                              Levels, Indexed, Bidirectional>& /*lhs*/,
+               const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                              Levels, Indexed, Bidirectional>& /*rhs*/) {
   throw std::runtime_error("Unimplemented!");
 }
 
 /**
  *
  */
-template <class Key, class T, class Compare, class Alloc>
-bool operator>=(const skip_map<Key, T, Compare, Alloc>& /*lhs*/,
-                const skip_map<Key, T, Compare, Alloc>& /*rhs*/) {
+template <class Key,
+          class T,
+          class Compare,
+          class Alloc,
+          size_t MaxLevel,
+          class Probability,
+          class Levels,
+          bool Indexed,
+          bool Bidirectional>
+bool operator>=(const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& /*lhs*/,
+                const skip_map<Key, T, Compare, Alloc, MaxLevel, Probability,
+                               Levels, Indexed, Bidirectional>& /*rhs*/) {
   throw std::runtime_error("Unimplemented!");
 }
 
 /**
  *
  */
-template <class Key, class T, class Compare, class Alloc>
-void swap(skip_map<Key, T, Compare, Alloc>& lhs,
-          skip_map<Key, T, Compare, Alloc>& rhs) {
-  std::swap(lhs.rend_, rhs.rend_);
-  std::swap(lhs.end_, rhs.end_);
+template <class Key,
+          class T,
+          class Compare,
+          class Alloc,
+          size_t MaxLevel,
+          class Probability,
+          class Levels,
+          bool Indexed,
+          bool Bidirectional>
+void swap(skip_map<Key, T, Compare, Alloc, MaxLevel, Probability, Levels,
+                   Indexed, Bidirectional>& lhs,
+          skip_map<Key, T, Compare, Alloc, MaxLevel, Probability, Levels,
+                   Indexed, Bidirectional>& rhs) {
+  lhs.swap(rhs);
 }
 
+/**
+ * skip_map with indexed links, see skip_map.
+ */
+template <class Key,
+          class T,
+          class Compare = std::less<Key>,
+          class Allocator = std::allocator<skip_map_node<Key, T>>>
+using indexed_skip_map =
+    skip_map<Key,
+             T,
+             Compare,
+             Allocator,
+             16,
+             std::ratio<1, 4>,
+             xorshift_level_generator<16, std::ratio<1, 4>>,
+             true>;
+
+/**
+ * skip_map with bidirectional iterators, see skip_map.
+ */
+template <class Key,
+          class T,
+          class Compare = std::less<Key>,
+          class Allocator = std::allocator<skip_map_node<Key, T>>>
+using bidirectional_skip_map =
+    skip_map<Key,
+             T,
+             Compare,
+             Allocator,
+             16,
+             std::ratio<1, 4>,
+             xorshift_level_generator<16, std::ratio<1, 4>>,
+             false,
+             true>;
+
 #endif /* skip_map_h */
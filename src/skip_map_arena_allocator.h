@@ -0,0 +1,201 @@
+#ifndef skip_map_arena_allocator_h
+#define skip_map_arena_allocator_h
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+
+/**
+ * Memory pool handing out the nodes of a skip_map. Memory is carved from large
+ * slabs with a bump pointer so nodes inserted one after the other end up next
+ * to each other, which helps the level 0 scans. Released blocks are kept in
+ * one free list per size class. Since nodes of the same height have the same
+ * size, the size classes end up being per height classes.
+ *
+ * Requests larger than max_pooled_size, or with an alignment stricter than
+ * granularity, are forwarded to the global operator new.
+ *
+ * Like skip_map, the arena is not thread safe.
+ */
+class skip_map_arena {
+ public:
+  static constexpr size_t granularity = alignof(std::max_align_t);
+  static constexpr size_t max_pooled_size = 1024;
+  static constexpr size_t default_slab_size = 64 * 1024;
+
+  explicit skip_map_arena(size_t slab_size = default_slab_size)
+      : slab_size_(std::max(slab_size, max_pooled_size)),
+        free_lists_(max_pooled_size / granularity + 1, nullptr) {}
+
+  skip_map_arena(const skip_map_arena&) = delete;
+  skip_map_arena& operator=(const skip_map_arena&) = delete;
+
+  ~skip_map_arena() { release(); }
+
+  /**
+   * Returns bytes of memory aligned on alignment.
+   */
+  void* allocate(size_t bytes, size_t alignment) {
+    if (!is_pooled(bytes, alignment)) {
+      ++large_allocations_;
+      return ::operator new(bytes, std::align_val_t(alignment));
+    }
+
+    const size_t size_class = size_class_of(bytes);
+    if (void* head = free_lists_[size_class]) {
+      free_lists_[size_class] = *static_cast<void**>(head);
+      return head;
+    }
+
+    const size_t size = size_class * granularity;
+    if (remaining_ < size) {
+      add_slab();
+    }
+
+    void* block = cursor_;
+    cursor_ += size;
+    remaining_ -= size;
+    return block;
+  }
+
+  /**
+   * Gives back memory obtained from allocate() with the same bytes and
+   * alignment. Pooled memory goes to the free list of its size class.
+   */
+  void deallocate(void* block, size_t bytes, size_t alignment) {
+    if (!is_pooled(bytes, alignment)) {
+      --large_allocations_;
+      ::operator delete(block, std::align_val_t(alignment));
+      return;
+    }
+
+    const size_t size_class = size_class_of(bytes);
+    *static_cast<void**>(block) = free_lists_[size_class];
+    free_lists_[size_class] = block;
+  }
+
+  /**
+   * Frees all the slabs at once, in O(slabs). Every pooled block handed out
+   * becomes invalid.
+   */
+  void release() {
+    for (auto slab : slabs_) {
+      ::operator delete(slab, std::align_val_t(granularity));
+    }
+    slabs_.clear();
+    std::fill(free_lists_.begin(), free_lists_.end(), nullptr);
+    cursor_ = nullptr;
+    remaining_ = 0;
+  }
+
+  /**
+   * Number of blocks handed out that were not taken from the slabs.
+   */
+  size_t large_allocations() const { return large_allocations_; }
+
+  /**
+   * Number of slabs currently held.
+   */
+  size_t slab_count() const { return slabs_.size(); }
+
+  size_t slab_size() const { return slab_size_; }
+
+ private:
+  static bool is_pooled(size_t bytes, size_t alignment) {
+    return bytes <= max_pooled_size && alignment <= granularity;
+  }
+
+  static size_t size_class_of(size_t bytes) {
+    // Free blocks hold the pointer to the next one.
+    bytes = std::max(bytes, sizeof(void*));
+    return (bytes + granularity - 1) / granularity;
+  }
+
+  void add_slab() {
+    // What is left of the current slab is smaller than the request and is
+    // simply abandoned.
+    auto slab = static_cast<unsigned char*>(
+        ::operator new(slab_size_, std::align_val_t(granularity)));
+    slabs_.push_back(slab);
+    cursor_ = slab;
+    remaining_ = slab_size_;
+  }
+
+  size_t slab_size_;
+  std::vector<void*> free_lists_;
+  std::vector<unsigned char*> slabs_;
+  unsigned char* cursor_{nullptr};
+  size_t remaining_{0};
+  size_t large_allocations_{0};
+};
+
+/**
+ * Allocator drawing from a skip_map_arena, usable as the Allocator of a
+ * skip_map. Every default constructed allocator owns a new arena, copies and
+ * rebinds share it. The arena lives as long as one of them does. A copied
+ * container gets a new arena of its own.
+ */
+template <class T>
+class skip_map_arena_allocator {
+ public:
+  using value_type = T;
+  using propagate_on_container_copy_assignment = std::true_type;
+  using propagate_on_container_move_assignment = std::true_type;
+  using propagate_on_container_swap = std::true_type;
+
+  skip_map_arena_allocator() : arena_(std::make_shared<skip_map_arena>()) {}
+
+  explicit skip_map_arena_allocator(size_t slab_size)
+      : arena_(std::make_shared<skip_map_arena>(slab_size)) {}
+
+  template <class U>
+  skip_map_arena_allocator(const skip_map_arena_allocator<U>& other)
+      : arena_(other.arena_) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, size_t n) {
+    arena_->deallocate(p, n * sizeof(T), alignof(T));
+  }
+
+  /**
+   * Frees the whole arena if this allocator is the only one using it and
+   * every block came from the slabs. Returns whether it did, in which case
+   * the memory handed out must not be deallocated anymore.
+   */
+  bool try_release() {
+    if (arena_.use_count() != 1 || arena_->large_allocations() != 0) {
+      return false;
+    }
+    arena_->release();
+    return true;
+  }
+
+  const skip_map_arena& arena() const { return *arena_; }
+
+  skip_map_arena_allocator select_on_container_copy_construction() const {
+    return skip_map_arena_allocator(arena_->slab_size());
+  }
+
+  template <class U>
+  bool operator==(const skip_map_arena_allocator<U>& other) const {
+    return arena_ == other.arena_;
+  }
+
+  template <class U>
+  bool operator!=(const skip_map_arena_allocator<U>& other) const {
+    return !(*this == other);
+  }
+
+ private:
+  template <class U>
+  friend class skip_map_arena_allocator;
+
+  std::shared_ptr<skip_map_arena> arena_;
+};
+
+#endif /* skip_map_arena_allocator_h */
@@ -0,0 +1,153 @@
+#ifndef skip_map_codec_h
+#define skip_map_codec_h
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+/**
+ * Layout of the streams written by skip_map::save(). A header is followed by
+ * blocks of elements in key order, each one preceded by its element count and
+ * its size in bytes. A block of zero elements ends the stream. Codecs restart
+ * at every block so a block is decoded on its own, and the reader only holds
+ * one block at a time.
+ *
+ * Headers are stored with the byte order of the writer.
+ */
+struct skip_map_stream {
+  static constexpr char magic[8] = {'s', 'k', 'i', 'p', 'm', 'a', 'p', 's'};
+  static constexpr std::uint32_t format = 1;
+
+  /**
+   * Encoded size after which a block is written out.
+   */
+  static constexpr size_t block_bytes = 64 * 1024;
+
+  struct header {
+    char magic[8];
+    std::uint32_t format;
+    std::uint32_t reserved;
+    std::uint64_t size;
+  };
+
+  struct block_header {
+    std::uint32_t count;
+    std::uint32_t bytes;
+  };
+
+  /**
+   * Appends value to out in 7 bits groups, lowest first.
+   */
+  static void write_varint(std::uint64_t value, std::string& out) {
+    while (value >= 0x80) {
+      out.push_back(static_cast<char>(value | 0x80));
+      value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+  }
+
+  static std::uint64_t read_varint(const char*& in, const char* end) {
+    std::uint64_t value = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      if (in == end) {
+        break;
+      }
+      const auto byte = static_cast<unsigned char>(*in++);
+      value |= std::uint64_t(byte & 0x7f) << shift;
+      if (byte < 0x80) {
+        return value;
+      }
+    }
+    throw std::runtime_error("skip_map: truncated varint");
+  }
+
+  static void check_available(const char* in, const char* end, size_t bytes) {
+    if (size_t(end - in) < bytes) {
+      throw std::runtime_error("skip_map: truncated block");
+    }
+  }
+};
+
+/**
+ * Default codec of skip_map::save() and load(). Trivially copyable types are
+ * stored as their bytes. A codec is reset at the start of every block and
+ * encodes or decodes the keys, or the values, of that block in order.
+ */
+template <class T>
+struct skip_map_codec {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "No default codec for this type");
+
+  void reset() {}
+
+  void encode(const T& value, std::string& out) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+  }
+
+  T decode(const char*& in, const char* end) {
+    skip_map_stream::check_available(in, end, sizeof(T));
+    T value;
+    std::memcpy(&value, in, sizeof(value));
+    in += sizeof(value);
+    return value;
+  }
+};
+
+/**
+ * Strings are stored as their length followed by their characters.
+ */
+template <class CharT, class Traits, class Allocator>
+struct skip_map_codec<std::basic_string<CharT, Traits, Allocator>> {
+  using string_type = std::basic_string<CharT, Traits, Allocator>;
+
+  void reset() {}
+
+  void encode(const string_type& value, std::string& out) {
+    skip_map_stream::write_varint(value.size(), out);
+    out.append(reinterpret_cast<const char*>(value.data()),
+               value.size() * sizeof(CharT));
+  }
+
+  string_type decode(const char*& in, const char* end) {
+    const auto length = skip_map_stream::read_varint(in, end);
+    if (length > size_t(end - in) / sizeof(CharT)) {
+      throw std::runtime_error("skip_map: truncated block");
+    }
+    string_type value(length, CharT());
+    std::memcpy(&value[0], in, length * sizeof(CharT));
+    in += length * sizeof(CharT);
+    return value;
+  }
+};
+
+/**
+ * Codec of integer keys storing the difference with the previous key of the
+ * block, zigzag encoded as a varint. Keys close to each other take one or
+ * two bytes whatever their type.
+ */
+template <class T>
+struct skip_map_delta_codec {
+  static_assert(std::is_integral<T>::value, "Deltas are taken on integers");
+
+  void reset() { previous_ = 0; }
+
+  void encode(const T& value, std::string& out) {
+    const std::uint64_t delta = std::uint64_t(value) - previous_;
+    previous_ = std::uint64_t(value);
+    skip_map_stream::write_varint(
+        (delta << 1) ^ std::uint64_t(std::int64_t(delta) >> 63), out);
+  }
+
+  T decode(const char*& in, const char* end) {
+    const auto zigzag = skip_map_stream::read_varint(in, end);
+    previous_ += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+    return static_cast<T>(previous_);
+  }
+
+ private:
+  std::uint64_t previous_ = 0;
+};
+
+#endif /* skip_map_codec_h */
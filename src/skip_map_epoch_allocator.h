@@ -0,0 +1,66 @@
+#ifndef skip_map_epoch_allocator_h
+#define skip_map_epoch_allocator_h
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include "epoch_domain.h"
+
+/**
+ * Allocator deferring the release of skip_map nodes through epoch_domain. A
+ * skip_map using it does not destroy the nodes it erases or clears right away
+ * but retires them, so threads holding an epoch_domain::guard can keep reading
+ * them until they unpin.
+ *
+ * The allocator is stateless, memory comes from the global operator new.
+ */
+template <class T>
+class skip_map_epoch_allocator {
+ public:
+  using value_type = T;
+  using is_always_equal = std::true_type;
+
+  skip_map_epoch_allocator() = default;
+
+  template <class U>
+  skip_map_epoch_allocator(const skip_map_epoch_allocator<U>&) {}
+
+  T* allocate(size_t n) {
+    return static_cast<T*>(
+        ::operator new(n * sizeof(T), std::align_val_t(alignof(T))));
+  }
+
+  void deallocate(T* p, size_t) {
+    ::operator delete(p, std::align_val_t(alignof(T)));
+  }
+
+  /**
+   * Destroys and frees node once no thread pinned before this call is still
+   * pinned. Used by skip_map instead of destroying the node itself.
+   */
+  template <class Node>
+  void retire(Node* node) {
+    epoch_domain::instance().retire(node, &destroy<Node>);
+  }
+
+  template <class U>
+  bool operator==(const skip_map_epoch_allocator<U>&) const {
+    return true;
+  }
+
+  template <class U>
+  bool operator!=(const skip_map_epoch_allocator<U>&) const {
+    return false;
+  }
+
+ private:
+  template <class Node>
+  static void destroy(void* node) {
+    skip_map_epoch_allocator<typename Node::block>().deallocate(
+        static_cast<typename Node::block*>(
+            Node::destroy(static_cast<Node*>(node))),
+        0);
+  }
+};
+
+#endif /* skip_map_epoch_allocator_h */
@@ -2,17 +2,29 @@
 #define skip_map_iterator_h
 
 #include <gtest/gtest_prod.h>
+#include <iterator>
+#include <type_traits>
 #include "skip_map_node.h"
 
+/**
+ * Iterator over the nodes of a skip_map. It is bidirectional when the nodes
+ * have back links, see skip_map's Bidirectional parameter, and forward only
+ * otherwise.
+ */
 template <typename Key,
           typename Value,
           bool is_const,
+          bool is_bidirectional = false,
           typename value_type =
               typename std::conditional<is_const,
                                         const std::pair<const Key, Value>,
                                         std::pair<const Key, Value>>::type>
 class skip_map_iterator
-    : public std::iterator<std::forward_iterator_tag, value_type> {
+    : public std::iterator<
+          typename std::conditional<is_bidirectional,
+                                    std::bidirectional_iterator_tag,
+                                    std::forward_iterator_tag>::type,
+          value_type> {
  public:
   using difference_type = std::ptrdiff_t;
   using node_pointer_type =
@@ -24,8 +36,12 @@ class skip_map_iterator
 
   skip_map_iterator(skip_map_node<Key, Value>* p, size_t level = 0)
       : level_(level), node(p) {}
-  skip_map_iterator(const skip_map_iterator<Key, Value, false>& other)
-      : level_(other.level_), node(other.node) {}
+  skip_map_iterator(
+      const skip_map_iterator<Key, Value, false, is_bidirectional>& other)
+      : level_(other.level_), node(other.get()) {}
+
+  // The constructor above is the copy constructor of mutable iterators.
+  skip_map_iterator& operator=(const skip_map_iterator&) = default;
 
   skip_map_iterator& operator++() {
     // Do not iterate into nullptr
@@ -43,6 +59,23 @@ class skip_map_iterator
     return tmp;
   }
 
+  /**
+   * Moves to the previous node through its back link, only on bidirectional
+   * iterators.
+   */
+  template <bool B = is_bidirectional, class = std::enable_if_t<B>>
+  skip_map_iterator& operator--() {
+    node = node->prev();
+    return *this;
+  }
+
+  template <bool B = is_bidirectional, class = std::enable_if_t<B>>
+  skip_map_iterator operator--(int) {
+    skip_map_iterator tmp(*this);
+    operator--();
+    return tmp;
+  }
+
   skip_map_iterator operator+(difference_type n) const {
     skip_map_iterator temp(*this);
     for (difference_type i = 0; temp.node && i < n; ++i) {
@@ -75,7 +108,6 @@ class skip_map_iterator
 
   // Friend classes only for unit tests
   friend class ConstructedTest;
-  FRIEND_TEST(ConstructedTest, splice);
 
   size_t level_;
 
@@ -1,48 +1,120 @@
 #ifndef skip_map_node_h
 #define skip_map_node_h
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <memory>
+#include <new>
 #include <utility>
-#include "fixed_vector.hpp"
-
-constexpr size_t MAX_SIZE{4};
 
 /**
  * The class that represents a node in the skip list. This class provides the
  * data representation but no logic. The logic is to be implemented in the
  * iterator and container classes built on top of it.
+ *
+ * A node and its links live in a single allocation. The tower of links is
+ * sized to the height of the node and is placed right in front of the entry:
+ *
+ *   [padding][link h-1]...[link 1][link 0][key][value][height]
+ *                                         ^ this
+ *
+ * This way the lowest links and the key share a cache line and a hop in the
+ * list only has to touch the next node instead of the node and a separate
+ * link buffer. Nodes are created and destroyed through create() and destroy()
+ * on storage obtained from an allocator of block.
  */
 template <class Key, class T>
 class skip_map_node {
  public:
+  using link_type = skip_map_node*;
+
+  /**
+   * Alignment required by the allocation holding the tower and the node.
+   */
+  static constexpr size_t alignment =
+      std::max(alignof(std::pair<const Key, T>), alignof(link_type));
+
+  /**
+   * Unit of storage in which nodes are allocated. Allocators are rebound to
+   * this type and asked for blocks_for(height) of them.
+   */
+  struct alignas(alignment) block {
+    unsigned char bytes[alignment];
+  };
+
+  /**
+   * Number of bytes taken by a tower of the given height, padding included.
+   */
+  static constexpr size_t tower_size(size_t height) {
+    return (height * sizeof(link_type) + alignment - 1) / alignment * alignment;
+  }
+
+  /**
+   * Number of blocks needed to hold a node of the given height.
+   */
+  static constexpr size_t blocks_for(size_t height) {
+    return (tower_size(height) + sizeof(skip_map_node) + sizeof(block) - 1) /
+           sizeof(block);
+  }
+
+  /**
+   * Constructs a node of the given height in storage, which has to be at least
+   * blocks_for(height) blocks long. All links are set to nullptr and the entry
+   * is constructed from arguments.
+   */
+  template <class... Args>
+  static skip_map_node* create(void* storage,
+                               size_t height,
+                               Args&&... arguments) {
+    auto* base = static_cast<unsigned char*>(storage);
+    auto* node = ::new (base + tower_size(height))
+        skip_map_node(height, std::forward<Args>(arguments)...);
+    std::uninitialized_fill_n(node->links_end() - height, height, nullptr);
+    return node;
+  }
+
+  /**
+   * Destroys the node and returns the storage it was created in.
+   */
+  static void* destroy(skip_map_node* node) {
+    void* storage = node->storage();
+    node->~skip_map_node();
+    return storage;
+  }
+
   /**
-   * The default constructor, only initilializes member variables
+   * Number of links in the tower of this node.
    */
-  skip_map_node() : entry{Key(), T()}, links{} {}
+  size_t height() const { return height_; }
 
   /**
-   * Constructor, sets the the entry member using the provided values.
+   * Start of the storage this node was created in.
    */
-  skip_map_node(Key key, T value) : entry{key, value}, links{} {}
+  void* storage() { return tower_begin(); }
+
+  /**
+   * Link to the previous node on the bottom level. It is stored right before
+   * the tower, only in nodes created with room for it by a bidirectional
+   * skip_map.
+   */
+  skip_map_node* prev() const { return *(tower_begin() - 1); }
+
+  void set_prev(skip_map_node* link) { *(tower_begin() - 1) = link; }
 
   /**
    * Accessor to get the link pointer at the desired index.
    * @param[in] i The index of the link.
    */
-  skip_map_node* link_at(size_t i) const { return links[i]; }
+  skip_map_node* link_at(size_t i) const { return *(links_end() - 1 - i); }
 
   /**
-   * Accessor to set the link pointer at the desired index.
-   * The link vector is grown to accomodate insertions
+   * Accessor to set the link pointer at the desired index. The index has to
+   * be smaller than height().
    * @param[in] link The new value for the pointer.
    */
   void set_link(size_t i, skip_map_node* link) {
-    if (links.size() < i + 1) {
-      links.resize(i + 1);
-    }
-
-    links.at(i) = link;
+    *(links_end() - 1 - i) = link;
   }
 
   /**
@@ -50,19 +122,38 @@ class skip_map_node {
    */
   std::pair<const Key, T> entry;
 
+ private:
   /**
-   * Fill levels to nullptr.
+   * Constructor, the entry is constructed in place from arguments. Without
+   * arguments both the key and the value are value initialized.
    */
-  void initialize_to_null() {
-    links = std::vector<skip_map_node*>(MAX_SIZE, nullptr);
+  template <class... Args>
+  explicit skip_map_node(size_t height, Args&&... arguments)
+      : entry(std::forward<Args>(arguments)...),
+        height_(static_cast<std::uint8_t>(height)) {}
+
+  /**
+   * The links used to go over the list are stored right before the node. The
+   * link at index 0 is essentially the same as the "next" pointer of a classic
+   * linked list and is the closest to the entry.
+   */
+  link_type* links_end() const {
+    return reinterpret_cast<link_type*>(const_cast<unsigned char*>(
+        reinterpret_cast<const unsigned char*>(this)));
+  }
+
+  /**
+   * Start of the tower, padding included.
+   */
+  link_type* tower_begin() const {
+    return reinterpret_cast<link_type*>(
+        reinterpret_cast<unsigned char*>(links_end()) - tower_size(height_));
   }
 
- private:
   /**
-   * The links used to go over the list. The link at index 0 is essentially the
-   * same as the "next" pointer of a classic linked list.
+   * Number of links in the tower.
    */
-  std::vector<skip_map_node*> links;
+  std::uint8_t height_;
 
   FRIEND_TEST(insert, increasing_levels);
 };
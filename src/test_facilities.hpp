@@ -1,5 +1,14 @@
 #pragma once
 
+#include <functional>
+#include <memory>
+#include <ratio>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include "compare_with_stats.h"
+#include "level_generator.h"
+
 constexpr const char* long_string{"This is a very long long long string"};
 constexpr int default_size{1000};
 constexpr int MAX_LEVEL = 4;
@@ -8,15 +17,100 @@ using Key = int;
 using Value = const char*;
 using KeyValue = std::pair<Key, Value>;
 
+// Counts the copies and moves of the objects of this type. The counters are
+// shared by all instances so they have to be reset at the start of a test.
+struct copy_counter {
+  copy_counter() = default;
+  explicit copy_counter(std::string v) : value(std::move(v)) {}
+  copy_counter(const copy_counter& other) : value(other.value) { ++copies; }
+  copy_counter(copy_counter&& other) : value(std::move(other.value)) {
+    ++moves;
+  }
+  copy_counter& operator=(const copy_counter& other) {
+    value = other.value;
+    ++copies;
+    return *this;
+  }
+  copy_counter& operator=(copy_counter&& other) {
+    value = std::move(other.value);
+    ++moves;
+    return *this;
+  }
+
+  static void reset() { copies = moves = 0; }
+
+  std::string value;
+
+  static inline size_t copies{0};
+  static inline size_t moves{0};
+};
+
+// Throws std::runtime_error from its copy constructor once copies_left copies
+// were made.
+struct copy_thrower {
+  copy_thrower() = default;
+  copy_thrower(const copy_thrower&) {
+    if (copies_left-- == 0) {
+      throw std::runtime_error("copy_thrower");
+    }
+  }
+
+  static inline size_t copies_left{0};
+};
+
+// Counters shared by all the counting_allocator types.
+struct allocation_counter {
+  static inline size_t allocations{0};
+  // Bytes currently allocated.
+  static inline size_t bytes{0};
+};
+
+// Allocator counting the calls to allocate() of every instance and rebind.
 template <typename T>
-struct compare_with_stats {
-  constexpr bool operator()(const T& lhs, const T& rhs) const {
-    ++compare_count;
-    return std::less<T>()(lhs, rhs);
+struct counting_allocator : allocation_counter {
+  using value_type = T;
+
+  counting_allocator() = default;
+  template <typename U>
+  counting_allocator(const counting_allocator<U>&) {}
+
+  T* allocate(size_t n) {
+    ++allocations;
+    bytes += n * sizeof(T);
+    return std::allocator<T>().allocate(n);
+  }
+
+  void deallocate(T* p, size_t n) {
+    bytes -= n * sizeof(T);
+    std::allocator<T>().deallocate(p, n);
+  }
+
+  template <typename U>
+  bool operator==(const counting_allocator<U>&) const {
+    return true;
   }
+  template <typename U>
+  bool operator!=(const counting_allocator<U>&) const {
+    return false;
+  }
+};
+
+// Level generator returning the levels of script once a test sets it, random
+// levels until then.
+struct scripted_levels {
+  explicit scripted_levels(std::function<size_t()> script = {})
+      : script(std::move(script)) {}
+
+  size_t operator()() { return script ? script() : random(); }
+
+  std::function<size_t()> script;
+  xorshift_level_generator<16, std::ratio<1, 4>> random;
+};
 
-  // We tolerate a mutable variable here as it is only for testing.
-  mutable size_t compare_count{0};
+// Level generator keeping every node on the bottom level, the skip_map is a
+// plain linked list.
+struct flat_levels {
+  size_t operator()() const { return 0; }
 };
 
 // Fil a container with increasingly large keys and the same value.
@@ -1,10 +1,30 @@
+#include <fstream>
 #include <iostream>
 #include <map>
+#include <shared_mutex>
+#include <sstream>
+#include <string_view>
+#include <thread>
+#include "concurrent_skip_map.h"
+#include "epoch_domain.h"
+#include "fixed_vector.hpp"
 #include "gtest/gtest.h"
+#include "lazy_skip_map.h"
+#include "mapped_skip_map.h"
 #include "skip_map.h"
+#include "skip_map_arena_allocator.h"
+#include "skip_map_epoch_allocator.h"
+#include "unrolled_skip_map.h"
+#include "versioned_skip_map.h"
 #include "test_facilities.hpp"
 
-using test_skip_map = skip_map<int, std::string, compare_with_stats<int>>;
+using test_skip_map = skip_map<int,
+                               std::string,
+                               compare_with_stats<int>,
+                               std::allocator<skip_map_node<int, std::string>>,
+                               16,
+                               std::ratio<1, 4>,
+                               scripted_levels>;
 
 class SkipMapTest : public ::testing::Test {
  protected:
@@ -124,7 +144,7 @@ TEST(compare_count, case1) {
 
   // Set the level we will use to avoid getting additional
   // comparisons from walking down levels.
-  sm.set_gen_for_testing([]() { return 0; });
+  sm.set_level_generator_for_testing(scripted_levels([]() { return 0; }));
 
   ASSERT_TRUE(sm.insert({0, ""}).second);
   sm.key_comparator_.compare_count = 0;
@@ -132,10 +152,27 @@ TEST(compare_count, case1) {
   ASSERT_TRUE(sm.insert({1, ""}).second);
 
   // One to check if the value in already there in insert().
-  // One to compare with the one value that is there in splice().
+  // One to compare with the one value that is there in predecessors().
   ASSERT_EQ(sm.key_comparator_.compare_count, 2);
 }
 
+TEST(compare_count, clear) {
+  test_skip_map sm;
+  fill(sm);
+
+  // Tearing down the list does not search for the nodes.
+  sm.key_comparator_.compare_count = 0;
+  sm.clear();
+  ASSERT_EQ(sm.key_comparator_.compare_count, 0);
+  ASSERT_TRUE(sm.empty());
+  ASSERT_EQ(sm.begin(), sm.end());
+
+  // The map is usable again after being cleared.
+  fill(sm, 10);
+  ASSERT_EQ(sm.size(), size_t(10));
+  ASSERT_EQ(sm.at(9), long_string);
+}
+
 TEST(insert, duplicates) {
   test_skip_map sm;
   ASSERT_TRUE(sm.insert({0, ""}).second);
@@ -150,7 +187,8 @@ TEST(insert, increasing_levels) {
   for (size_t level : level_sequence) {
     ++increasing_key;
 
-    sm.set_gen_for_testing([level]() { return level; });
+    sm.set_level_generator_for_testing(
+        scripted_levels([level]() { return level; }));
 
     bool success;
     test_skip_map::iterator iterator;
@@ -158,13 +196,292 @@ TEST(insert, increasing_levels) {
         sm.insert({increasing_key, std::to_string(increasing_key)});
 
     ASSERT_TRUE(success);
-    ASSERT_EQ(iterator.node->links.size(), level + 1);
+    ASSERT_EQ(iterator.node->height(), level + 1);
     ASSERT_EQ(iterator->second, std::to_string(increasing_key));
   }
 
   EXPECT_EQ(sm.size(), level_sequence.size());
 }
 
+TEST(insert, mixed_levels) {
+  test_skip_map sm;
+  std::map<int, std::string> map;
+
+  // Cycle through every level so that towers of all heights are interleaved.
+  size_t level = 0;
+  sm.set_level_generator_for_testing(
+      scripted_levels([&level]() { return level++ % MAX_LEVEL; }));
+
+  for (int i = 0; i < 100; ++i) {
+    int key = (i * 37) % 100;
+    sm.insert({key, std::to_string(key)});
+    map.insert({key, std::to_string(key)});
+  }
+
+  for (int key = 0; key < 100; key += 2) {
+    sm.erase(key);
+    map.erase(key);
+  }
+
+  ASSERT_EQ(sm.size(), map.size());
+  for (const auto& key_value : map) {
+    ASSERT_EQ(sm.at(key_value.first), key_value.second);
+  }
+  for (int key = 0; key < 100; key += 2) {
+    ASSERT_EQ(sm.find(key), sm.end());
+  }
+}
+
+// Checks the odds of promotion at the first levels of levels.
+template <class Generator>
+void check_promotions(Generator levels, size_t max_level, double probability) {
+  const size_t draws = 100000;
+  std::vector<size_t> reached(max_level, 0);
+  for (size_t i = 0; i < draws; ++i) {
+    size_t value = levels();
+    ASSERT_LT(value, max_level);
+    for (size_t level = 0; level <= value; ++level) {
+      ++reached[level];
+    }
+  }
+
+  for (size_t level = 1; level < 3; ++level) {
+    EXPECT_NEAR(static_cast<double>(reached[level]) / reached[level - 1],
+                probability, 0.02);
+  }
+}
+
+TEST(levels, distribution) {
+  check_promotions(xorshift_level_generator<4, std::ratio<1, 2>>(), 4, 0.5);
+  check_promotions(xorshift_level_generator<16, std::ratio<1, 4>>(), 16, 0.25);
+  // Not a power of two, drawn level by level.
+  check_promotions(xorshift_level_generator<8, std::ratio<1, 3>>(), 8, 1. / 3);
+}
+
+TEST(levels, seeded) {
+  using generator = xorshift_level_generator<16, std::ratio<1, 4>>;
+  using seeded_skip_map = skip_map<int, int>;
+  seeded_skip_map sm1(generator(42));
+  seeded_skip_map sm2(generator(42));
+  seeded_skip_map sm3(generator(43));
+  for (int i = 0; i < 1000; ++i) {
+    sm1.emplace(i, i);
+    sm2.emplace(i, i);
+    sm3.emplace(i, i);
+  }
+
+  // The same seed gives the same towers.
+  auto heights = [](const seeded_skip_map& sm) {
+    std::vector<size_t> result;
+    for (auto it = sm.begin(); it != sm.end(); ++it) {
+      result.push_back(it.get()->height());
+    }
+    return result;
+  };
+  EXPECT_EQ(heights(sm1), heights(sm2));
+  EXPECT_NE(heights(sm1), heights(sm3));
+
+  // Copies continue with the same draws.
+  seeded_skip_map copy(sm1);
+  copy.emplace(1000, 0);
+  sm1.emplace(1000, 0);
+  EXPECT_EQ(heights(copy), heights(sm1));
+}
+
+TEST(lookup, bounds_of_missing_keys) {
+  test_skip_map sm;
+  std::map<int, std::string> map;
+  for (int i = 0; i < 100; i += 3) {
+    sm.insert({i, std::to_string(i)});
+    map.insert({i, std::to_string(i)});
+  }
+
+  for (int key = -1; key < 102; ++key) {
+    auto expect = [&](auto sm_it, auto map_it) {
+      if (map_it == map.end()) {
+        ASSERT_EQ(sm_it, sm.end());
+      } else {
+        ASSERT_EQ(sm_it->first, map_it->first);
+      }
+    };
+    expect(sm.lower_bound(key), map.lower_bound(key));
+    expect(sm.upper_bound(key), map.upper_bound(key));
+    expect(sm.find(key), map.find(key));
+    ASSERT_EQ(sm.contains(key), map.count(key) == 1);
+  }
+}
+
+TEST(lookup, transparent) {
+  static_assert(std::is_same_v<skip_map<int, int>::key_compare, std::less<int>>,
+                "Plain std::less by default");
+
+  // std::string is not implicitly constructible from std::string_view, the
+  // lookups compile only if they compare the view with the keys directly.
+  skip_map<std::string, int, std::less<>> sm;
+  for (int i = 10; i < 100; i += 2) {
+    sm.emplace(std::to_string(i), i);
+  }
+
+  using namespace std::literals;
+  ASSERT_EQ(sm.find("42"sv)->second, 42);
+  ASSERT_EQ(sm.find("43"sv), sm.end());
+  ASSERT_TRUE(sm.contains("98"sv));
+  ASSERT_EQ(sm.count("99"sv), size_t(0));
+  ASSERT_EQ(sm.lower_bound("43"sv)->second, 44);
+  ASSERT_EQ(sm.upper_bound("44"sv)->second, 46);
+  auto range = sm.equal_range("50"sv);
+  ASSERT_EQ(range.first->second, 50);
+  ASSERT_EQ(range.second->second, 52);
+
+  const auto& const_sm = sm;
+  ASSERT_EQ(const_sm.find("10"sv), const_sm.begin());
+  ASSERT_EQ(const_sm.lower_bound("99"sv), const_sm.end());
+
+  // Keys still convert for the regular overloads.
+  ASSERT_EQ(sm.at("64"), 64);
+}
+
+TEST(levels, grow_with_size) {
+  test_skip_map sm;
+  fill(sm, 100000);
+
+  // log4(100000) is a bit more than 8.
+  EXPECT_GE(sm.max_level_, size_t(5));
+
+  // A lookup has to stay logarithmic instead of walking a long level.
+  sm.key_comparator_.compare_count = 0;
+  ASSERT_NE(sm.find(77777), sm.end());
+  EXPECT_LT(sm.key_comparator_.compare_count, size_t(200));
+}
+
+TEST(stats, structure) {
+  test_skip_map sm;
+  auto stats = sm.stats();
+  ASSERT_EQ(stats.size, size_t(0));
+  ASSERT_EQ(stats.sampled_searches, size_t(0));
+  ASSERT_EQ(stats.nodes_per_level, std::vector<size_t>{0});
+
+  // Every height from 1 to MAX_LEVEL on 25 nodes each.
+  size_t level = 0;
+  sm.set_level_generator_for_testing(
+      scripted_levels([&level]() { return level++ % MAX_LEVEL; }));
+  fill(sm, 100);
+
+  stats = sm.stats();
+  ASSERT_EQ(stats.size, size_t(100));
+  ASSERT_EQ(stats.max_level, size_t(MAX_LEVEL - 1));
+  ASSERT_EQ(stats.nodes_per_level, (std::vector<size_t>{100, 75, 50, 25}));
+  ASSERT_EQ(stats.height_histogram, (std::vector<size_t>{25, 25, 25, 25}));
+
+  using node_type = test_skip_map::node_type;
+  size_t node_bytes = 0;
+  size_t link_bytes = 0;
+  for (size_t height : {1, 2, 3, 4, 16, 16}) {
+    size_t count = height == 16 ? 1 : 25;
+    node_bytes += count * node_type::blocks_for(height) *
+                  sizeof(typename node_type::block);
+    link_bytes += count * node_type::tower_size(height);
+  }
+  ASSERT_EQ(stats.node_bytes, node_bytes);
+  ASSERT_EQ(stats.link_bytes, link_bytes);
+
+  // A flat list walks up to every sampled key on the bottom level.
+  test_skip_map flat;
+  flat.set_level_generator_for_testing(scripted_levels([]() { return 0; }));
+  fill(flat, 100);
+  stats = flat.stats(10);
+  ASSERT_EQ(stats.sampled_searches, size_t(10));
+  ASSERT_EQ(stats.max_level, size_t(0));
+  ASSERT_DOUBLE_EQ(stats.average_hops[0], 45.);
+  ASSERT_EQ(stats.max_hops[0], size_t(90));
+
+  // The default structure stays logarithmic.
+  test_skip_map large;
+  fill(large, 100000);
+  stats = large.stats();
+  ASSERT_EQ(stats.max_level, large.max_level_);
+  for (size_t hops : stats.max_hops) {
+    EXPECT_LT(hops, size_t(64));
+  }
+}
+
+using counting_skip_map = skip_map<int,
+                                   copy_counter,
+                                   compare_with_stats<int>,
+                                   counting_allocator<copy_counter>>;
+
+TEST(emplace, try_emplace_in_place) {
+  counting_skip_map sm;
+  copy_counter::reset();
+  size_t allocations = allocation_counter::allocations;
+
+  // The value is constructed in the node from the string.
+  auto result = sm.try_emplace(1, std::string("one"));
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(result.first->second.value, "one");
+  ASSERT_EQ(allocation_counter::allocations, allocations + 1);
+
+  // A failed try_emplace does not allocate nor touch its arguments.
+  std::string other("other");
+  result = sm.try_emplace(1, std::move(other));
+  ASSERT_FALSE(result.second);
+  ASSERT_EQ(result.first->second.value, "one");
+  ASSERT_EQ(other, "other");
+  ASSERT_EQ(allocation_counter::allocations, allocations + 1);
+
+  // Default construction in place through operator[].
+  sm[2].value = "two";
+  ASSERT_EQ(sm.at(2).value, "two");
+  ASSERT_EQ(allocation_counter::allocations, allocations + 2);
+
+  ASSERT_EQ(copy_counter::copies, size_t(0));
+  ASSERT_EQ(copy_counter::moves, size_t(0));
+}
+
+TEST(emplace, emplace_piecewise) {
+  counting_skip_map sm;
+  copy_counter::reset();
+
+  auto result = sm.emplace(std::piecewise_construct, std::forward_as_tuple(1),
+                           std::forward_as_tuple("one"));
+  ASSERT_TRUE(result.second);
+  ASSERT_EQ(sm.at(1).value, "one");
+
+  auto it = sm.emplace_hint(sm.cend(), std::piecewise_construct,
+                            std::forward_as_tuple(2),
+                            std::forward_as_tuple("two"));
+  ASSERT_EQ(it->second.value, "two");
+
+  // Already present, the node built for the element is released.
+  result = sm.emplace(std::piecewise_construct, std::forward_as_tuple(1),
+                      std::forward_as_tuple("not one"));
+  ASSERT_FALSE(result.second);
+  ASSERT_EQ(sm.at(1).value, "one");
+  ASSERT_EQ(sm.size(), size_t(2));
+
+  ASSERT_EQ(copy_counter::copies, size_t(0));
+  ASSERT_EQ(copy_counter::moves, size_t(0));
+}
+
+TEST(emplace, insert_or_assign) {
+  counting_skip_map sm;
+  copy_counter::reset();
+
+  ASSERT_TRUE(sm.insert_or_assign(1, copy_counter("one")).second);
+  ASSERT_EQ(copy_counter::moves, size_t(1));
+
+  ASSERT_FALSE(sm.insert_or_assign(1, copy_counter("uno")).second);
+  ASSERT_EQ(sm.at(1).value, "uno");
+  ASSERT_EQ(copy_counter::moves, size_t(2));
+
+  // One move to build the value_type, one to move it into the node.
+  ASSERT_TRUE(sm.insert({2, copy_counter("two")}).second);
+  ASSERT_EQ(copy_counter::moves, size_t(4));
+
+  ASSERT_EQ(copy_counter::copies, size_t(0));
+  ASSERT_EQ(sm.size(), size_t(2));
+}
+
 TEST(static_case, constness) {
   test_skip_map sm;
 
@@ -218,6 +535,62 @@ TEST_F(SkipMapTest, copying) {
   ASSERT_NE(sm1, sm3);
 }
 
+TEST(copying, preserves_structure) {
+  test_skip_map sm;
+  fill(sm, 1000);
+
+  test_skip_map copy(sm);
+  ASSERT_EQ(copy.max_level_, sm.max_level_);
+  ASSERT_EQ(copy.size(), sm.size());
+
+  auto it1 = sm.cbegin();
+  auto it2 = copy.cbegin();
+  for (; it1 != sm.cend(); ++it1, ++it2) {
+    ASSERT_EQ(*it1, *it2);
+    ASSERT_NE(it1.get(), it2.get());
+    ASSERT_EQ(it1.get()->height(), it2.get()->height());
+  }
+  ASSERT_EQ(it2, copy.cend());
+
+  // No search is needed to build the copy.
+  ASSERT_EQ(copy.key_comparator_.compare_count,
+            sm.key_comparator_.compare_count);
+}
+
+TEST(copying, carries_comparator) {
+  test_skip_map sm;
+  fill(sm, 100);
+  const size_t compare_count = sm.key_comparator_.compare_count;
+  ASSERT_GT(compare_count, size_t(0));
+
+  // The nodes are ordered by the comparator that comes with them.
+  test_skip_map assigned;
+  assigned = sm;
+  ASSERT_EQ(assigned.key_comparator_.compare_count, compare_count);
+  test_skip_map moved(std::move(assigned));
+  ASSERT_EQ(moved.key_comparator_.compare_count, compare_count);
+  test_skip_map swapped;
+  swapped.swap(moved);
+  ASSERT_EQ(swapped.key_comparator_.compare_count, compare_count);
+  ASSERT_EQ(moved.key_comparator_.compare_count, size_t(0));
+}
+
+TEST(copying, releases_nodes_on_throw) {
+  using thrower_map = skip_map<int, copy_thrower, std::less<int>,
+                               counting_allocator<copy_thrower>>;
+  thrower_map sm;
+  for (int i = 0; i < 100; ++i) {
+    sm.emplace(std::piecewise_construct, std::forward_as_tuple(i),
+               std::forward_as_tuple());
+  }
+
+  const size_t bytes = allocation_counter::bytes;
+  copy_thrower::copies_left = 49;
+  ASSERT_THROW(thrower_map copy(sm), std::runtime_error);
+  ASSERT_EQ(allocation_counter::bytes, bytes);
+  ASSERT_EQ(sm.size(), size_t(100));
+}
+
 TEST_F(SkipMapTest, move_construction) {
   test_skip_map sm1;
 
@@ -288,6 +661,460 @@ TEST_F(SkipMapTest, erase) {
   }
 }
 
+TEST_F(SkipMapTest, erase_count) {
+  auto map_pair = create_identical_maps(mixed_data);
+
+  auto& sm = map_pair.first;
+  auto& map = map_pair.second;
+
+  for (const auto& key_value : mixed_data) {
+    ASSERT_EQ(sm.erase(key_value.first), map.erase(key_value.first));
+    ASSERT_EQ(sm.size(), map.size());
+  }
+  ASSERT_TRUE(sm.empty());
+}
+
+TEST_F(SkipMapTest, swap) {
+  auto map_pair = create_identical_maps(mixed_data);
+  auto& sm = map_pair.first;
+  auto& map = map_pair.second;
+
+  test_skip_map other;
+  other.insert({42, "reponse"});
+
+  swap(sm, other);
+  ASSERT_EQ(sm.size(), size_t(1));
+  ASSERT_EQ(other.size(), map.size());
+  ASSERT_EQ(sm.at(42), "reponse");
+  for (const auto& key_value : map) {
+    ASSERT_EQ(other.at(key_value.first), key_value.second);
+  }
+
+  test_skip_map moved(std::move(other));
+  ASSERT_EQ(moved.size(), map.size());
+}
+
+TEST_F(SkipMapTest, range_insert) {
+  std::map<int, std::string> map;
+  test_skip_map sm;
+
+  // Unsorted with duplicates into an empty map.
+  sm.insert(mixed_data.begin(), mixed_data.end());
+  map.insert(mixed_data.begin(), mixed_data.end());
+  ASSERT_EQ(sm.size(), map.size());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), sm.begin()));
+
+  // Sorted and after the existing keys.
+  std::vector<std::pair<int, std::string>> tail{{10, "a"}, {11, "b"}};
+  sm.insert(tail.begin(), tail.end());
+  map.insert(tail.begin(), tail.end());
+
+  // Interleaved with the existing keys.
+  sm.insert({{7, "c"}, {-1, "d"}, {10, "not inserted"}});
+  map.insert({{7, "c"}, {-1, "d"}, {10, "not inserted"}});
+
+  ASSERT_EQ(sm.size(), map.size());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), sm.begin()));
+  for (const auto& key_value : map) {
+    ASSERT_EQ(sm.at(key_value.first), key_value.second);
+  }
+}
+
+TEST(insert, hint_in_order) {
+  test_skip_map sm;
+
+  const int size = 10000;
+  for (int i = 0; i < size; ++i) {
+    auto it = sm.emplace_hint(sm.cend(), i, std::to_string(i));
+    ASSERT_EQ(it->first, i);
+  }
+
+  // Appending from the finger costs a constant number of comparisons per
+  // element instead of a full search.
+  EXPECT_LT(sm.key_comparator_.compare_count, size_t(size * 6));
+
+  ASSERT_EQ(sm.size(), size_t(size));
+  int expected = 0;
+  for (const auto& key_value : sm) {
+    ASSERT_EQ(key_value.first, expected++);
+  }
+}
+
+TEST(insert, hint_mixed_with_erase) {
+  test_skip_map sm;
+  std::map<int, std::string> map;
+
+  // Insertion points before and after the finger, with erased fingers.
+  for (int i = 0; i < 2000; ++i) {
+    int key = (i * 7919) % 1000;
+    test_skip_map::value_type value{key, std::to_string(i)};
+    auto it = sm.insert(sm.cbegin(), value);
+    ASSERT_EQ(it->first, key);
+    map.insert(value);
+
+    if (i % 3 == 0) {
+      ASSERT_EQ(sm.erase(key), map.erase(key));
+    }
+  }
+
+  ASSERT_EQ(sm.size(), map.size());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), sm.begin()));
+}
+
+TEST(construction, sorted_unique) {
+  std::vector<test_skip_map::value_type> data;
+  for (int i = 0; i < 1000; ++i) {
+    data.emplace_back(i * 2, std::to_string(i));
+  }
+
+  test_skip_map sm(sorted_unique, data.begin(), data.end());
+  ASSERT_EQ(sm.size(), data.size());
+  ASSERT_TRUE(std::equal(data.begin(), data.end(), sm.begin()));
+  ASSERT_EQ(sm.at(500), "250");
+  ASSERT_EQ(sm.find(501), sm.end());
+
+  // The built map has to keep working as a regular one.
+  sm.insert({501, "odd"});
+  sm.erase(500);
+  ASSERT_EQ(sm.at(501), "odd");
+  ASSERT_EQ(sm.size(), data.size());
+}
+
+TEST(construction, ranges) {
+  test_skip_map from_list{{3, "c"}, {1, "a"}, {2, "b"}, {1, "z"}};
+  ASSERT_EQ(from_list.size(), size_t(3));
+  ASSERT_EQ(from_list.at(1), "a");
+  ASSERT_EQ(from_list.begin()->first, 1);
+
+  test_skip_map from_range(from_list.begin(), from_list.end());
+  ASSERT_EQ(from_range, from_list);
+}
+
+TEST(erase, ranges) {
+  test_skip_map sm;
+  std::map<int, std::string> map;
+  for (int i = 0; i < 1000; ++i) {
+    sm.insert({i, std::to_string(i)});
+    map.insert({i, std::to_string(i)});
+  }
+
+  auto check = [&sm, &map](int from, int to) {
+    auto sm_it = sm.erase(sm.lower_bound(from), sm.lower_bound(to));
+    auto map_it = map.erase(map.lower_bound(from), map.lower_bound(to));
+    ASSERT_EQ(sm_it == sm.end(), map_it == map.end());
+    if (map_it != map.end()) {
+      ASSERT_EQ(sm_it->first, map_it->first);
+    }
+    ASSERT_EQ(sm.size(), map.size());
+    ASSERT_TRUE(std::equal(map.begin(), map.end(), sm.begin()));
+  };
+
+  check(0, 100);     // Prefix
+  check(500, 600);   // Middle
+  check(650, 650);   // Empty range
+  check(900, 1000);  // Suffix
+
+  // Every level still has to be usable.
+  for (int i = 0; i < 1000; ++i) {
+    ASSERT_EQ(sm.count(i), map.count(i));
+  }
+
+  check(0, 1000);  // Everything
+  ASSERT_TRUE(sm.empty());
+}
+
+TEST(erase, successive) {
+  test_skip_map sm;
+  fill(sm, 10000);
+
+  // Erasing from the position of the previous erase does not search.
+  sm.key_comparator_.compare_count = 0;
+  for (auto it = sm.find(5000); it != sm.end();) {
+    it = sm.erase(it);
+  }
+  EXPECT_LT(sm.key_comparator_.compare_count, size_t(5000 * 4));
+
+  ASSERT_EQ(sm.size(), size_t(5000));
+  ASSERT_EQ(sm.find(4999)->first, 4999);
+  ASSERT_EQ(sm.find(5000), sm.end());
+}
+
+TEST(batch, find) {
+  test_skip_map sm;
+  fill(sm, 1000);
+
+  std::vector<int> keys{-1, 0, 3, 3, 500, 999, 1000, 2000};
+  std::vector<test_skip_map::iterator> found;
+  sm.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+  ASSERT_EQ(found.size(), keys.size());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(found[i], sm.find(keys[i]));
+  }
+
+  // Unsorted keys are found too.
+  std::vector<int> unsorted{700, 2, 701, -5, 5};
+  std::vector<test_skip_map::const_iterator> const_found;
+  const test_skip_map& const_sm = sm;
+  const_sm.find_batch(unsorted.begin(), unsorted.end(),
+                      std::back_inserter(const_found));
+  for (size_t i = 0; i < unsorted.size(); ++i) {
+    ASSERT_EQ(const_found[i], const_sm.find(unsorted[i]));
+  }
+}
+
+// Checks nth(), rank() and distance() of an indexed map against a walk of
+// the list.
+template <class Map>
+void check_indexes(const Map& sm) {
+  size_t index = 0;
+  for (auto it = sm.begin(); it != sm.end(); ++it, ++index) {
+    ASSERT_EQ(sm.nth(index), it);
+    ASSERT_EQ(sm.rank(it->first), index);
+    ASSERT_EQ(sm.distance(sm.begin(), it), static_cast<ptrdiff_t>(index));
+    ASSERT_EQ(sm.distance(it, sm.end()),
+              static_cast<ptrdiff_t>(sm.size() - index));
+  }
+  ASSERT_EQ(index, sm.size());
+  ASSERT_EQ(sm.nth(sm.size()), sm.end());
+}
+
+TEST(indexed, nth_and_rank) {
+  indexed_skip_map<int, int> sm;
+  check_indexes(sm);
+
+  std::minstd_rand rand;
+  for (int i = 0; i < 1000; ++i) {
+    int key = rand() % 2000;
+    sm.emplace(key * 2, key);
+  }
+  check_indexes(sm);
+
+  // Missing keys rank like their lower bound.
+  ASSERT_EQ(sm.rank(-1), size_t(0));
+  ASSERT_EQ(sm.rank(1), size_t(sm.begin()->first < 1));
+  ASSERT_EQ(sm.rank(100000), sm.size());
+
+  for (int i = 0; i < 300; ++i) {
+    sm.erase((rand() % 2000) * 2);
+  }
+  check_indexes(sm);
+
+  // Range erasure, hints and batches.
+  sm.erase(sm.nth(100), sm.nth(250));
+  for (int i = 4001; i < 4400; i += 2) {
+    sm.emplace_hint(sm.end(), i, i);
+  }
+  std::vector<std::pair<int, int>> batch;
+  for (int i = 1; i < 4000; i += 16) {
+    batch.emplace_back(i, i);
+  }
+  sm.insert_batch(batch.begin(), batch.end());
+  check_indexes(sm);
+
+  std::vector<int> keys;
+  for (int i = 1; i < 4000; i += 32) {
+    keys.push_back(i);
+  }
+  sm.erase_batch(keys.begin(), keys.end());
+  check_indexes(sm);
+
+  // Appending a sorted range and copying.
+  sm.insert(batch.end() - 1, batch.end());
+  std::vector<std::pair<int, int>> tail{{5000, 0}, {5001, 0}, {5002, 0}};
+  sm.insert(tail.begin(), tail.end());
+  auto copy = sm;
+  check_indexes(copy);
+  ASSERT_EQ(copy.nth(copy.size() - 1)->first, 5002);
+
+  sm.clear();
+  check_indexes(sm);
+  sm.emplace(1, 1);
+  check_indexes(sm);
+}
+
+TEST(indexed, sorted_construction) {
+  std::vector<std::pair<int, std::string>> data;
+  for (int i = 0; i < 1000; ++i) {
+    data.emplace_back(i * 3, std::to_string(i));
+  }
+  const indexed_skip_map<int, std::string> sm(sorted_unique, data.begin(),
+                                              data.end());
+  check_indexes(sm);
+  ASSERT_EQ(sm.nth(990)->second, "990");
+  ASSERT_EQ(sm.rank(1500), size_t(500));
+  ASSERT_EQ(sm.distance(sm.find(300), sm.find(600)), 100);
+  ASSERT_EQ(sm.distance(sm.find(600), sm.find(300)), -100);
+}
+
+// Checks that walking backward from end() meets every element of sm in
+// reverse order.
+template <class Map>
+void check_back_links(const Map& sm) {
+  std::vector<typename Map::key_type> forward;
+  for (const auto& key_value : sm) {
+    forward.push_back(key_value.first);
+  }
+  std::vector<typename Map::key_type> backward;
+  for (auto it = sm.rbegin(); it != sm.rend(); ++it) {
+    backward.push_back(it->first);
+  }
+  std::reverse(backward.begin(), backward.end());
+  ASSERT_EQ(forward, backward);
+}
+
+TEST(bidirectional, reverse_iteration) {
+  using map_type = bidirectional_skip_map<int, std::string>;
+  static_assert(std::is_same_v<std::iterator_traits<
+                                   map_type::iterator>::iterator_category,
+                               std::bidirectional_iterator_tag>,
+                "Back links make the iterators bidirectional");
+
+  map_type sm;
+  ASSERT_EQ(sm.rbegin(), sm.rend());
+
+  std::minstd_rand rand;
+  for (int i = 0; i < 1000; ++i) {
+    int key = rand() % 2000;
+    sm.emplace(key, std::to_string(key));
+  }
+  check_back_links(sm);
+  ASSERT_EQ(std::prev(sm.end())->first, sm.rbegin()->first);
+  auto last = sm.end();
+  --last;
+  ASSERT_EQ(last->first, sm.crbegin()->first);
+
+  for (int i = 0; i < 300; ++i) {
+    sm.erase(rand() % 2000);
+  }
+  sm.erase(std::next(sm.begin(), 10), std::next(sm.begin(), 50));
+  sm.erase(std::prev(sm.end()));
+  check_back_links(sm);
+
+  std::vector<std::pair<int, std::string>> tail;
+  for (int i = 3000; i < 3100; ++i) {
+    tail.emplace_back(i, std::to_string(i));
+  }
+  sm.insert(tail.begin(), tail.end());
+  auto copy = sm;
+  check_back_links(copy);
+  ASSERT_EQ(copy.rbegin()->first, 3099);
+
+  // The latest entries without walking the whole map.
+  std::vector<int> latest;
+  for (auto it = copy.rbegin(); latest.size() < 3; ++it) {
+    latest.push_back(it->first);
+  }
+  ASSERT_EQ(latest, (std::vector<int>{3099, 3098, 3097}));
+
+  sm.clear();
+  ASSERT_EQ(sm.rbegin(), sm.rend());
+  sm.emplace(1, "1");
+  check_back_links(sm);
+}
+
+TEST(bidirectional, indexed) {
+  // Both the widths and the back link in front of the towers.
+  skip_map<int, int, std::less<int>,
+           std::allocator<skip_map_node<int, int>>, 16, std::ratio<1, 4>,
+           xorshift_level_generator<16, std::ratio<1, 4>>, true, true>
+      sm;
+  std::minstd_rand rand;
+  for (int i = 0; i < 1000; ++i) {
+    sm.emplace(rand() % 2000, i);
+  }
+  for (int i = 0; i < 300; ++i) {
+    sm.erase(rand() % 2000);
+  }
+  check_indexes(sm);
+  check_back_links(sm);
+}
+
+TEST(batch, fewer_comparisons) {
+  // Searching from the previous key saves most of the descent from the top.
+  test_skip_map sm;
+  fill(sm, 100000);
+
+  std::vector<int> keys;
+  for (int i = 0; i < 100000; i += 10) {
+    keys.push_back(i);
+  }
+
+  sm.key_comparator_.compare_count = 0;
+  for (auto key : keys) {
+    sm.find(key);
+  }
+  const size_t individual = sm.key_comparator_.compare_count;
+
+  sm.key_comparator_.compare_count = 0;
+  std::vector<test_skip_map::iterator> found;
+  sm.find_batch(keys.begin(), keys.end(), std::back_inserter(found));
+  EXPECT_LT(sm.key_comparator_.compare_count, individual * 2 / 3);
+}
+
+TEST(batch, interleaved) {
+  test_skip_map sm;
+  for (int i = 0; i < 5000; i += 2) {
+    sm.insert({i, std::to_string(i)});
+  }
+
+  std::minstd_rand rand;
+  std::vector<int> keys(1000);
+  for (auto& key : keys) {
+    key = rand() % 5100 - 50;
+  }
+
+  std::vector<test_skip_map::iterator> found(keys.size());
+  auto end = sm.find_interleaved(keys.begin(), keys.end(), found.begin());
+  ASSERT_EQ(end, found.end());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(found[i], sm.find(keys[i]));
+  }
+
+  // Fewer keys than lanes, a single lane and nothing to look up.
+  const test_skip_map& const_sm = sm;
+  std::vector<test_skip_map::const_iterator> const_found(3);
+  const_sm.find_interleaved<16>(keys.begin(), keys.begin() + 3,
+                                const_found.begin());
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_EQ(const_found[i], const_sm.find(keys[i]));
+  }
+  sm.find_interleaved<1>(keys.begin(), keys.end(), found.begin());
+  for (size_t i = 0; i < keys.size(); ++i) {
+    ASSERT_EQ(found[i], sm.find(keys[i]));
+  }
+  ASSERT_EQ(sm.find_interleaved(keys.begin(), keys.begin(), found.begin()),
+            found.begin());
+}
+
+TEST(batch, insert_and_erase) {
+  test_skip_map sm;
+  std::map<int, std::string> map;
+  for (int i = 0; i < 1000; i += 3) {
+    sm.insert({i, "old"});
+    map.insert({i, "old"});
+  }
+
+  std::vector<std::pair<int, std::string>> values;
+  for (int i = 0; i < 1000; i += 2) {
+    values.emplace_back(i, "new");
+  }
+  ASSERT_EQ(sm.insert_batch(values.begin(), values.end()),
+            size_t(500 - 167));
+  map.insert(values.begin(), values.end());
+  ASSERT_EQ(sm.size(), map.size());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), sm.begin()));
+
+  std::vector<int> keys;
+  for (int i = 0; i < 1200; i += 5) {
+    keys.push_back(i);
+    map.erase(i);
+  }
+  const size_t removed = sm.size() - map.size();
+  ASSERT_EQ(sm.erase_batch(keys.begin(), keys.end()), removed);
+  ASSERT_EQ(sm.size(), map.size());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), sm.begin()));
+}
+
 //-----------------------------------------------------------------------------
 // array tests------------------------------------------------------------------
 //-----------------------------------------------------------------------------
@@ -334,6 +1161,978 @@ TEST_F(FixedVectorTest, push_back) {
   ASSERT_FALSE(data.full());
 }
 
+//-----------------------------------------------------------------------------
+// arena tests------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(arena, reuses_blocks) {
+  skip_map_arena arena(4096);
+
+  void* first = arena.allocate(40, 8);
+  void* second = arena.allocate(40, 8);
+  ASSERT_NE(first, second);
+  ASSERT_EQ(arena.slab_count(), size_t(1));
+
+  // Same size class, the freed block is handed out again.
+  arena.deallocate(first, 40, 8);
+  ASSERT_EQ(arena.allocate(33, 8), first);
+
+  // Too large for the slabs.
+  void* large = arena.allocate(4096, 8);
+  ASSERT_EQ(arena.large_allocations(), size_t(1));
+  arena.deallocate(large, 4096, 8);
+  ASSERT_EQ(arena.large_allocations(), size_t(0));
+
+  arena.release();
+  ASSERT_EQ(arena.slab_count(), size_t(0));
+}
+
+TEST(arena, skip_map_churn) {
+  using arena_skip_map =
+      skip_map<int, std::string, compare_with_stats<int>,
+               skip_map_arena_allocator<std::pair<const int, std::string>>>;
+
+  arena_skip_map sm;
+  std::map<int, std::string> map;
+  for (int i = 0; i < 5000; ++i) {
+    int key = (i * 7919) % 2000;
+    if (i % 3 == 0) {
+      ASSERT_EQ(sm.erase(key), map.erase(key));
+    } else {
+      ASSERT_EQ(sm.insert({key, std::to_string(i)}).second,
+                map.insert({key, std::to_string(i)}).second);
+    }
+  }
+  ASSERT_EQ(sm.size(), map.size());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), sm.begin()));
+
+  // Moves and copies keep nodes with the arena they came from.
+  arena_skip_map moved(std::move(sm));
+  arena_skip_map copy(moved);
+  copy.erase(copy.begin(), copy.end());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), moved.begin()));
+  ASSERT_NE(moved.get_allocator(), copy.get_allocator());
+}
+
+TEST(arena, unrolled_copy) {
+  using arena_unrolled_map =
+      unrolled_skip_map<int, int, std::less<int>,
+                        skip_map_arena_allocator<std::pair<const int, int>>>;
+
+  // Same rules as skip_map, the copy draws from a new arena.
+  arena_unrolled_map um;
+  for (int i = 0; i < 1000; ++i) {
+    um.try_emplace(i, i);
+  }
+  arena_unrolled_map copy(um);
+  ASSERT_NE(um.get_allocator(), copy.get_allocator());
+  ASSERT_TRUE(std::equal(um.begin(), um.end(), copy.begin(), copy.end()));
+}
+
+TEST(arena, bulk_release) {
+  skip_map_arena_allocator<int> allocator;
+  allocator.allocate(1);
+
+  // The arena can only be dropped by its last user.
+  {
+    skip_map_arena_allocator<double> shared(allocator);
+    ASSERT_FALSE(shared.try_release());
+  }
+  ASSERT_TRUE(allocator.try_release());
+  ASSERT_EQ(allocator.arena().slab_count(), size_t(0));
+
+  // The elements are trivially destructible, the map frees its arena without
+  // walking the nodes.
+  using arena_skip_map =
+      skip_map<int, int, compare_with_stats<int>,
+               skip_map_arena_allocator<std::pair<const int, int>>>;
+  arena_skip_map sm;
+  for (int i = 0; i < 10000; ++i) {
+    sm.emplace(i, i);
+  }
+  ASSERT_GT(sm.get_allocator().arena().slab_count(), size_t(1));
+}
+
+//-----------------------------------------------------------------------------
+// concurrent tests-------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+// Maps usable from several threads, they share the same interface.
+template <class Map>
+class ConcurrentTest : public ::testing::Test {};
+
+using concurrent_maps =
+    ::testing::Types<concurrent_skip_map<int, std::string>,
+                     lazy_skip_map<int, std::string>,
+                     versioned_skip_map<int, std::string>>;
+TYPED_TEST_SUITE(ConcurrentTest, concurrent_maps);
+
+TYPED_TEST(ConcurrentTest, single_thread) {
+  TypeParam csm;
+  std::map<int, std::string> map;
+
+  for (int i = 0; i < 1000; ++i) {
+    int key = (i * 7919) % 1000;
+    ASSERT_EQ(csm.insert({key, std::to_string(i)}),
+              map.insert({key, std::to_string(i)}).second);
+  }
+  ASSERT_FALSE(csm.try_emplace(5, "duplicate"));
+  ASSERT_EQ(csm.size(), map.size());
+
+  for (int i = 0; i < 1000; i += 3) {
+    ASSERT_TRUE(csm.erase(i));
+    map.erase(i);
+  }
+  ASSERT_FALSE(csm.erase(0));
+  ASSERT_EQ(csm.size(), map.size());
+
+  ASSERT_EQ(*csm.find(1), map.find(1)->second);
+  ASSERT_FALSE(csm.find(3));
+  ASSERT_FALSE(csm.contains(999));
+  ASSERT_EQ(csm.lower_bound(996)->first, 997);
+  ASSERT_FALSE(csm.lower_bound(999));
+
+  std::vector<std::pair<const int, std::string>> elements;
+  csm.for_each([&](const auto& entry) { elements.push_back(entry); });
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), elements.begin(),
+                         elements.end()));
+}
+
+TYPED_TEST(ConcurrentTest, mixed_operations) {
+  TypeParam csm;
+  constexpr int thread_count = 4;
+  constexpr int keys_per_thread = 5000;
+
+  // Every thread owns a set of keys it inserts and erases while the others
+  // keep reading the whole range.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&csm, t] {
+      for (int i = 0; i < keys_per_thread; ++i) {
+        int key = i * thread_count + t;
+        ASSERT_TRUE(csm.try_emplace(key, std::to_string(key)));
+        if (i % 2 == 0) {
+          ASSERT_TRUE(csm.erase(key));
+        }
+        auto value = csm.find(i * thread_count);
+        if (value) {
+          ASSERT_EQ(*value, std::to_string(i * thread_count));
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(csm.size(), size_t(thread_count * keys_per_thread / 2));
+  int previous = -1;
+  size_t count = 0;
+  csm.for_each([&](const auto& entry) {
+    ASSERT_LT(previous, entry.first);
+    ASSERT_EQ(entry.first / thread_count % 2, 1);
+    previous = entry.first;
+    ++count;
+  });
+  ASSERT_EQ(count, csm.size());
+}
+
+TYPED_TEST(ConcurrentTest, contended_keys) {
+  TypeParam csm;
+  constexpr int thread_count = 4;
+  std::atomic<int> inserted{0};
+  std::atomic<int> erased{0};
+
+  // All the threads fight over the same few keys, each successful insert and
+  // erase is counted once.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < thread_count; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 20000; ++i) {
+        int key = i % 16;
+        if (csm.try_emplace(key, std::to_string(i))) {
+          ++inserted;
+        }
+        if (csm.erase((i + 8) % 16)) {
+          ++erased;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  ASSERT_EQ(csm.size(), size_t(inserted - erased));
+  size_t count = 0;
+  csm.for_each([&](const auto&) { ++count; });
+  ASSERT_EQ(count, csm.size());
+}
+
+TEST(versioned, snapshot_isolation) {
+  versioned_skip_map<int, std::string> vsm;
+  for (int i = 0; i < 100; ++i) {
+    vsm.insert({i, std::to_string(i)});
+  }
+  auto before = vsm.snapshot();
+
+  // Writes after the snapshot only show in the map.
+  vsm.erase(10);
+  vsm.insert_or_assign(20, "twenty");
+  vsm.insert({100, "100"});
+  ASSERT_FALSE(vsm.contains(10));
+  ASSERT_EQ(*vsm.find(20), "twenty");
+  ASSERT_EQ(vsm.size(), size_t(100));
+
+  auto after = vsm.snapshot();
+  ASSERT_EQ(before.size(), size_t(100));
+  ASSERT_EQ(after.version(), before.version() + 3);
+  ASSERT_EQ(before.find(10)->second, "10");
+  ASSERT_EQ(before.find(20)->second, "20");
+  ASSERT_EQ(before.find(100), before.end());
+  ASSERT_EQ(after.find(10), after.end());
+  ASSERT_EQ(after.find(20)->second, "twenty");
+  ASSERT_EQ(after.lower_bound(10)->first, 11);
+
+  int expected = 0;
+  for (const auto& entry : before) {
+    ASSERT_EQ(entry.first, expected);
+    ASSERT_EQ(entry.second, std::to_string(expected));
+    ++expected;
+  }
+  ASSERT_EQ(expected, 100);
+  ASSERT_EQ(size_t(std::distance(after.begin(), after.end())), after.size());
+}
+
+TEST(versioned, reclaims_old_versions) {
+  versioned_skip_map<int, std::string> vsm;
+  for (int i = 0; i < 100; ++i) {
+    vsm.insert({i, std::to_string(i)});
+  }
+
+  // Without snapshots nothing is kept.
+  vsm.insert_or_assign(0, "zero");
+  vsm.erase(1);
+  ASSERT_EQ(vsm.stale_count(), size_t(0));
+
+  auto first = vsm.snapshot();
+  for (int i = 0; i < 50; ++i) {
+    vsm.insert_or_assign(i, "new");
+  }
+  auto second = vsm.snapshot();
+  auto copy = second;
+  for (int i = 50; i < 99; ++i) {
+    vsm.erase(i);
+  }
+  ASSERT_EQ(vsm.stale_count(), size_t(98));
+
+  // Versions go away with the last snapshot seeing them.
+  first = std::move(copy);
+  ASSERT_EQ(vsm.stale_count(), size_t(49));
+  ASSERT_EQ(first.find(0)->second, "new");
+  ASSERT_EQ(first.find(60)->second, "60");
+  second = vsm.snapshot();
+  ASSERT_EQ(vsm.stale_count(), size_t(49));
+  first = vsm.snapshot();
+  ASSERT_EQ(vsm.stale_count(), size_t(0));
+  ASSERT_EQ(first.size(), size_t(51));
+  ASSERT_EQ(size_t(std::distance(first.begin(), first.end())), first.size());
+}
+
+TEST(versioned, live_reads_during_assignments) {
+  versioned_skip_map<int, std::string> vsm;
+  constexpr int key_count = 64;
+  for (int key = 0; key < key_count; ++key) {
+    vsm.insert({key, std::to_string(key)});
+  }
+  std::atomic<bool> done{false};
+
+  // Every key is in every version, readers of the latest version must find
+  // them all while the writer keeps overwriting them.
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; ++t) {
+    readers.emplace_back([&] {
+      while (!done) {
+        for (int key = 0; key < key_count; ++key) {
+          ASSERT_TRUE(vsm.find(key));
+          ASSERT_TRUE(vsm.contains(key));
+          ASSERT_EQ(vsm.lower_bound(key)->first, key);
+        }
+        int count = 0;
+        vsm.for_each([&count](const auto&) { ++count; });
+        ASSERT_EQ(count, key_count);
+      }
+    });
+  }
+
+  for (int i = 0; i < 100000; ++i) {
+    vsm.insert_or_assign(i % key_count, std::to_string(i));
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(vsm.size(), size_t(key_count));
+}
+
+TEST(versioned, concurrent_snapshots) {
+  versioned_skip_map<int, std::string> vsm;
+  constexpr int window = 64;
+  std::atomic<bool> done{false};
+
+  // The writer slides a window of keys and rewrites it from time to time.
+  // Every snapshot has to see a whole window, the same one on each read.
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; ++t) {
+    readers.emplace_back([&] {
+      while (!done) {
+        auto snapshot = vsm.snapshot();
+        std::vector<std::pair<int, std::string>> first(snapshot.begin(),
+                                                       snapshot.end());
+        ASSERT_EQ(first.size(), snapshot.size());
+        for (size_t i = 1; i < first.size(); ++i) {
+          ASSERT_EQ(first[i].first, first[i - 1].first + 1);
+        }
+        std::vector<std::pair<int, std::string>> second(snapshot.begin(),
+                                                        snapshot.end());
+        ASSERT_EQ(first, second);
+      }
+    });
+  }
+
+  for (int i = 0; i < 20000; ++i) {
+    vsm.insert({i + window, long_string});
+    vsm.erase(i);
+    if (i % 1000 == 0) {
+      auto snapshot = vsm.snapshot();
+      for (int key = i + 1; key <= i + window; ++key) {
+        vsm.insert_or_assign(key, std::to_string(i) + long_string);
+      }
+    }
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ASSERT_EQ(vsm.size(), size_t(window));
+  ASSERT_EQ(vsm.stale_count(), size_t(0));
+}
+
+//-----------------------------------------------------------------------------
+// epoch tests------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(epoch, defers_while_pinned) {
+  static std::atomic<bool> freed;
+  freed = false;
+  std::atomic<bool> pinned{false};
+  std::atomic<bool> done{false};
+
+  std::thread reader([&] {
+    epoch_domain::guard guard;
+    pinned = true;
+    while (!done) {
+      std::this_thread::yield();
+    }
+  });
+  while (!pinned) {
+    std::this_thread::yield();
+  }
+
+  auto& domain = epoch_domain::instance();
+  domain.retire(new int(1), [](void* object) {
+    delete static_cast<int*>(object);
+    freed = true;
+  });
+  for (int i = 0; i < 10; ++i) {
+    domain.collect();
+  }
+  ASSERT_FALSE(freed);
+
+  done = true;
+  reader.join();
+  domain.synchronize();
+  ASSERT_TRUE(freed);
+  ASSERT_EQ(domain.pending(), size_t(0));
+}
+
+using epoch_skip_map =
+    skip_map<int, std::string, compare_with_stats<int>,
+             skip_map_epoch_allocator<std::pair<const int, std::string>>>;
+
+TEST(epoch, skip_map_deferred_erase) {
+  epoch_skip_map sm;
+  for (int i = 0; i < 100; ++i) {
+    sm.emplace(i, std::to_string(i) + long_string);
+  }
+
+  // Erased and cleared entries stay readable until the guard is dropped.
+  auto& domain = epoch_domain::instance();
+  {
+    epoch_domain::guard guard;
+    const std::string& first = sm.find(0)->second;
+    const std::string& last = sm.find(99)->second;
+    sm.erase(0);
+    sm.clear();
+    domain.collect();
+    ASSERT_EQ(first, std::to_string(0) + long_string);
+    ASSERT_EQ(last, std::to_string(99) + long_string);
+    ASSERT_GE(domain.pending(), size_t(100));
+  }
+  domain.synchronize();
+  ASSERT_EQ(domain.pending(), size_t(0));
+}
+
+// Set by a test to look up the nodes handed to retire() by their key.
+std::function<bool(int, const void*)> retired_node_reachable;
+
+// Epoch allocator checking that the nodes it retires cannot be reached from
+// their skip_map anymore.
+template <class T>
+struct checked_epoch_allocator : skip_map_epoch_allocator<T> {
+  checked_epoch_allocator() = default;
+  template <class U>
+  checked_epoch_allocator(const checked_epoch_allocator<U>&) {}
+
+  template <class Node>
+  void retire(Node* node) {
+    EXPECT_FALSE(retired_node_reachable &&
+                 retired_node_reachable(node->entry.first, node));
+    skip_map_epoch_allocator<T>::retire(node);
+  }
+};
+
+TEST(epoch, skip_map_range_erase_under_readers) {
+  skip_map<int, std::string, std::less<int>,
+           checked_epoch_allocator<std::pair<const int, std::string>>>
+      sm;
+  std::shared_mutex mutex;
+  constexpr int key_count = 4 * epoch_domain::collect_threshold;
+  constexpr int range = 2 * epoch_domain::collect_threshold;
+  auto refill = [&sm] {
+    for (int key = 0; key < key_count; ++key) {
+      sm.emplace(key, std::to_string(key) + long_string);
+    }
+  };
+  refill();
+  retired_node_reachable = [&sm](int key, const void* node) {
+    auto it = sm.find(key);
+    return it != sm.end() && it.get() == node;
+  };
+
+  // Readers keep the entries they found after unlocking, the guard keeps the
+  // nodes erased meanwhile alive. ASan reports any node freed too early.
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 2; ++t) {
+    readers.emplace_back([&] {
+      while (!done) {
+        epoch_domain::guard guard;
+        std::vector<std::pair<int, const std::string*>> found;
+        {
+          std::shared_lock<std::shared_mutex> lock(mutex);
+          for (int key = 0; key < key_count; key += 8) {
+            auto it = sm.find(key);
+            if (it != sm.end()) {
+              found.emplace_back(key, &it->second);
+            }
+          }
+        }
+        std::this_thread::yield();
+        for (const auto& [key, value] : found) {
+          ASSERT_EQ(*value, std::to_string(key) + long_string);
+        }
+      }
+    });
+  }
+
+  for (int round = 0; round < 200; ++round) {
+    const int first = round % (key_count - range);
+    {
+      std::unique_lock<std::shared_mutex> lock(mutex);
+      if (round % 20 == 0) {
+        sm.clear();
+      } else {
+        sm.erase(sm.lower_bound(first), sm.lower_bound(first + range));
+      }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    refill();
+  }
+  done = true;
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  retired_node_reachable = nullptr;
+  epoch_domain::instance().synchronize();
+}
+
+TEST(epoch, bounded_under_churn) {
+  epoch_skip_map sm;
+  auto& domain = epoch_domain::instance();
+  size_t most_pending = 0;
+  for (int i = 0; i < 100000; ++i) {
+    sm.emplace(i, long_string);
+    if (i >= 100) {
+      sm.erase(i - 100);
+    }
+    most_pending = std::max(most_pending, domain.pending());
+  }
+  ASSERT_LT(most_pending, 4 * epoch_domain::collect_threshold);
+}
+
+TEST(epoch, concurrent_readers) {
+  concurrent_skip_map<int, std::string> csm;
+  constexpr int key_range = 256;
+  std::atomic<bool> done{false};
+
+  // Readers go over nodes the writers keep erasing, ASan reports any node
+  // freed too early.
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 2; ++t) {
+    threads.emplace_back([&] {
+      while (!done) {
+        csm.for_each([](const auto& entry) {
+          ASSERT_EQ(entry.second, std::to_string(entry.first) + long_string);
+        });
+        for (int key = 0; key < key_range; key += 7) {
+          if (auto entry = csm.lower_bound(key)) {
+            ASSERT_GE(entry->first, key);
+          }
+        }
+      }
+    });
+  }
+
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 2; ++t) {
+    writers.emplace_back([&csm, t] {
+      for (int i = 0; i < 50000; ++i) {
+        int key = (i * 31 + t) % key_range;
+        csm.try_emplace(key, std::to_string(key) + long_string);
+        csm.erase((key + key_range / 2) % key_range);
+      }
+      epoch_domain::instance().synchronize();
+    });
+  }
+  for (auto& writer : writers) {
+    writer.join();
+  }
+  done = true;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+//-----------------------------------------------------------------------------
+// unrolled tests---------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+using test_unrolled_map =
+    unrolled_skip_map<int, std::string, std::less<int>,
+                      std::allocator<std::pair<const int, std::string>>, 4>;
+
+template <class Map>
+void expect_same_elements(const Map& map,
+                          const std::map<int, std::string>& expected) {
+  ASSERT_EQ(map.size(), expected.size());
+  auto it = map.begin();
+  for (const auto& entry : expected) {
+    ASSERT_NE(it, map.end());
+    ASSERT_EQ(it->first, entry.first);
+    ASSERT_EQ(it->second, entry.second);
+    ++it;
+  }
+  ASSERT_EQ(it, map.end());
+}
+
+TEST(unrolled, matches_map) {
+  test_unrolled_map um;
+  std::map<int, std::string> map;
+
+  std::minstd_rand rand;
+  for (int i = 0; i < 20000; ++i) {
+    int key = rand() % 500;
+    if (rand() % 3) {
+      auto value = std::to_string(i);
+      ASSERT_EQ(um.insert({key, value}).second,
+                map.insert({key, value}).second);
+    } else {
+      ASSERT_EQ(um.erase(key), map.erase(key));
+    }
+
+    int probe = rand() % 520 - 10;
+    auto expected = map.lower_bound(probe);
+    auto found = um.lower_bound(probe);
+    if (expected == map.end()) {
+      ASSERT_EQ(found, um.end());
+    } else {
+      ASSERT_EQ(found->first, expected->first);
+    }
+    ASSERT_EQ(um.contains(probe), map.count(probe) == 1);
+  }
+  expect_same_elements(um, map);
+
+  for (const auto& entry : map) {
+    ASSERT_EQ(um.at(entry.first), entry.second);
+  }
+  ASSERT_THROW(um.at(-1), std::out_of_range);
+}
+
+TEST(unrolled, blocks) {
+  test_unrolled_map um;
+  for (int i = 0; i < 1000; ++i) {
+    um[i] = std::to_string(i);
+  }
+
+  // Splitting keeps blocks at least half full.
+  ASSERT_LE(um.block_count(), size_t(1000 / 2));
+  ASSERT_GE(um.block_count(), size_t(1000 / 4));
+
+  // Erasing merges blocks and frees empty ones.
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 10) {
+      ASSERT_EQ(um.erase(i), size_t(1));
+    }
+  }
+  ASSERT_EQ(um.size(), size_t(100));
+  ASSERT_LE(um.block_count(), size_t(100));
+  for (int i = 0; i < 1000; i += 10) {
+    ASSERT_EQ(um.erase(i), size_t(1));
+  }
+  ASSERT_TRUE(um.empty());
+  ASSERT_EQ(um.block_count(), size_t(0));
+  ASSERT_EQ(um.begin(), um.end());
+
+  um.insert({7, "seven"});
+  ASSERT_EQ(um.at(7), "seven");
+}
+
+TEST(unrolled, copy_and_move) {
+  test_unrolled_map um{{3, "three"}, {1, "one"}, {2, "two"}};
+  std::map<int, std::string> map{{3, "three"}, {1, "one"}, {2, "two"}};
+  for (int i = 10; i < 100; ++i) {
+    um.try_emplace(i, std::to_string(i));
+    map.try_emplace(i, std::to_string(i));
+  }
+
+  test_unrolled_map copy(um);
+  expect_same_elements(copy, map);
+  ASSERT_EQ(copy.block_count(), um.block_count());
+
+  test_unrolled_map moved(std::move(um));
+  expect_same_elements(moved, map);
+
+  test_unrolled_map assigned;
+  assigned = copy;
+  copy.clear();
+  ASSERT_TRUE(copy.empty());
+  expect_same_elements(assigned, map);
+
+  swap(assigned, copy);
+  expect_same_elements(copy, map);
+  ASSERT_TRUE(assigned.empty());
+}
+
+//-----------------------------------------------------------------------------
+// simd tests-------------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+template <class Key>
+void check_lower_bounds() {
+  constexpr size_t capacity = 20;
+  const Key low = std::numeric_limits<Key>::min();
+  const Key high = std::numeric_limits<Key>::max();
+  std::vector<Key> keys{low, low + 1, 0, 2, 3, 3, 7, 100, high - 1, high};
+  std::sort(keys.begin(), keys.end());
+  keys.resize(capacity, Key(42));
+
+  std::vector<Key> probes{low, low + 1, 0, 1, 3, 4, 99, 101, high - 1, high};
+  for (size_t size = 0; size <= 10; ++size) {
+    for (auto probe : probes) {
+      const size_t expected =
+          std::lower_bound(keys.begin(), keys.begin() + size, probe) -
+          keys.begin();
+      ASSERT_EQ(simd_lower_bound(keys.data(), size, capacity, probe), expected);
+      ASSERT_EQ(branchless_lower_bound(keys.data(), size, probe), expected);
+    }
+  }
+
+  // No vector fits in the capacity.
+  ASSERT_EQ(simd_lower_bound(keys.data(), 3, 3, Key(1)),
+            size_t(std::lower_bound(keys.begin(), keys.begin() + 3, Key(1)) -
+                   keys.begin()));
+}
+
+TEST(simd, lower_bound) {
+  check_lower_bounds<int32_t>();
+  check_lower_bounds<uint32_t>();
+  check_lower_bounds<int64_t>();
+  check_lower_bounds<uint64_t>();
+}
+
+TEST(simd, searchable_keys) {
+  ASSERT_TRUE((is_simd_searchable_v<int, std::less<int>>));
+  ASSERT_TRUE((is_simd_searchable_v<uint64_t, std::less<>>));
+  ASSERT_FALSE((is_simd_searchable_v<int, std::greater<int>>));
+  ASSERT_FALSE((is_simd_searchable_v<int, compare_with_stats<int>>));
+  ASSERT_FALSE((is_simd_searchable_v<double, std::less<double>>));
+  ASSERT_FALSE((is_simd_searchable_v<int16_t, std::less<int16_t>>));
+}
+
+TEST(unrolled, integer_keys) {
+  unrolled_skip_map<uint64_t, int> um;
+  std::map<uint64_t, int> map;
+  std::mt19937_64 rand;
+  for (int i = 0; i < 5000; ++i) {
+    // Spread over the whole range, sign bit included.
+    uint64_t key = rand() | (uint64_t(i % 2) << 63);
+    um.try_emplace(key, i);
+    map.try_emplace(key, i);
+  }
+  for (int i = 0; i < 1000; ++i) {
+    uint64_t probe = rand();
+    auto expected = map.lower_bound(probe);
+    auto found = um.lower_bound(probe);
+    if (expected == map.end()) {
+      ASSERT_EQ(found, um.end());
+    } else {
+      ASSERT_EQ(found->first, expected->first);
+    }
+  }
+  for (const auto& entry : map) {
+    ASSERT_EQ(um.at(entry.first), entry.second);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// mapped tests-----------------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+using test_mapped_map = mapped_skip_map<int, double>;
+
+static std::string mapped_path() {
+  return ::testing::TempDir() + "mapped_skip_map_test";
+}
+
+template <class Map>
+static test_mapped_map write_and_map(const Map& map) {
+  {
+    std::ofstream out(mapped_path(), std::ios::binary | std::ios::trunc);
+    test_mapped_map::write(out, map);
+  }
+  return test_mapped_map(mapped_path());
+}
+
+TEST(mapped, round_trip) {
+  // Sizes around powers of the fan out change the number of levels.
+  for (int size : {0, 1, 3, 4, 5, 16, 17, 1000}) {
+    skip_map<int, double> sm;
+    for (int i = 0; i < size; ++i) {
+      sm.emplace(i * 2, i * 0.5);
+    }
+    auto mapped = write_and_map(sm);
+    ASSERT_EQ(mapped.size(), sm.size());
+    ASSERT_EQ(mapped.empty(), sm.empty());
+
+    auto it = mapped.begin();
+    for (const auto& entry : sm) {
+      ASSERT_NE(it, mapped.end());
+      ASSERT_EQ(it->first, entry.first);
+      ASSERT_EQ(it->second, entry.second);
+      ++it;
+    }
+    ASSERT_EQ(it, mapped.end());
+
+    for (int key = -1; key <= size * 2; ++key) {
+      auto expected = sm.lower_bound(key);
+      auto found = mapped.lower_bound(key);
+      if (expected == sm.end()) {
+        ASSERT_EQ(found, mapped.end());
+        ASSERT_EQ(mapped.upper_bound(key), mapped.end());
+      } else {
+        ASSERT_EQ(found->first, expected->first);
+        ASSERT_EQ(mapped.contains(key), sm.contains(key));
+        if (auto upper = sm.upper_bound(key); upper != sm.end()) {
+          ASSERT_EQ(mapped.upper_bound(key)->first, upper->first);
+        }
+      }
+    }
+  }
+}
+
+TEST(mapped, lookups) {
+  std::map<int, double> map;
+  for (int i = 0; i < 100; ++i) {
+    map.emplace(i * 3, i);
+  }
+  auto mapped = write_and_map(map);
+  ASSERT_EQ(mapped.levels(), size_t(4));
+  ASSERT_EQ(mapped.at(30), 10);
+  ASSERT_THROW(mapped.at(31), std::out_of_range);
+  ASSERT_EQ(mapped.find(31), mapped.end());
+  ASSERT_EQ(mapped.count(297), size_t(1));
+  ASSERT_EQ(mapped.count(298), size_t(0));
+
+  // The view outlives the moves.
+  test_mapped_map moved(std::move(mapped));
+  ASSERT_EQ(moved.find(297)->second, 99);
+}
+
+TEST(mapped, rejects_other_files) {
+  ASSERT_THROW(test_mapped_map{mapped_path() + "_missing"}, std::system_error);
+  {
+    std::ofstream out(mapped_path(), std::ios::binary | std::ios::trunc);
+    out << "not a skip map, though long enough for a header";
+  }
+  ASSERT_THROW(test_mapped_map{mapped_path()}, std::runtime_error);
+
+  // Same file read with other types.
+  skip_map<int, double> sm;
+  sm.emplace(1, 1.0);
+  {
+    std::ofstream out(mapped_path(), std::ios::binary | std::ios::trunc);
+    test_mapped_map::write(out, sm);
+  }
+  using other_map = mapped_skip_map<int64_t, double>;
+  ASSERT_THROW(other_map{mapped_path()}, std::runtime_error);
+
+  // Headers of the right types whose layout is corrupt, padding keeps the
+  // file size consistent with the header.
+  std::string file;
+  {
+    std::ifstream in(mapped_path(), std::ios::binary);
+    file.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  auto corrupt = [&file](auto&& change, size_t padding = 0) {
+    mapped_skip_map_header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    change(header);
+    std::ofstream out(mapped_path(), std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(file.data() + sizeof(header), file.size() - sizeof(header));
+    out << std::string(padding, '\0');
+  };
+  corrupt([](mapped_skip_map_header&) {});
+  ASSERT_EQ(test_mapped_map{mapped_path()}.at(1), 1.0);
+  corrupt([](mapped_skip_map_header& header) { header.levels = 64; });
+  ASSERT_THROW(test_mapped_map{mapped_path()}, std::runtime_error);
+  corrupt([](mapped_skip_map_header& header) { header.levels = 0; });
+  ASSERT_THROW(test_mapped_map{mapped_path()}, std::runtime_error);
+  corrupt([](mapped_skip_map_header& header) { header.head += 4096; });
+  ASSERT_THROW(test_mapped_map{mapped_path()}, std::runtime_error);
+  // One more level for one element only adds a link to the head.
+  corrupt(
+      [](mapped_skip_map_header& header) {
+        ++header.levels;
+        header.head += sizeof(std::uint64_t);
+      },
+      sizeof(std::uint64_t));
+  ASSERT_THROW(test_mapped_map{mapped_path()}, std::runtime_error);
+}
+
+//-----------------------------------------------------------------------------
+// serialization tests----------------------------------------------------------
+//-----------------------------------------------------------------------------
+
+TEST(serialization, round_trip) {
+  // Long values span many blocks, the empty map only has the end block.
+  for (int size : {0, 1, 20000}) {
+    skip_map<int, std::string> sm;
+    for (int i = 0; i < size; ++i) {
+      sm.emplace(i * 7 - size, std::to_string(i) + long_string);
+    }
+
+    std::stringstream stream;
+    sm.save(stream);
+    skip_map<int, std::string> loaded;
+    loaded.emplace(1, "replaced");
+    loaded.load(stream);
+    ASSERT_EQ(loaded, sm);
+
+    // Appending after a load starts from the built tail.
+    loaded.emplace_hint(loaded.end(), size * 7, "last");
+    ASSERT_EQ(loaded.size(), sm.size() + 1);
+    ASSERT_EQ(loaded.find(size * 7)->second, "last");
+  }
+}
+
+TEST(serialization, delta_codec) {
+  std::map<int64_t, int> map;
+  std::minstd_rand rand;
+  for (int i = 0; i < 50000; ++i) {
+    int64_t key = int64_t(rand()) * (i % 2 ? 1 : -4096);
+    map.emplace(key, i);
+  }
+  skip_map<int64_t, int> sm(map.begin(), map.end());
+
+  std::stringstream raw;
+  sm.save(raw);
+  std::stringstream delta;
+  sm.save(delta, skip_map_delta_codec<int64_t>());
+  ASSERT_LT(delta.str().size(), raw.str().size());
+
+  skip_map<int64_t, int> loaded;
+  loaded.load(delta, skip_map_delta_codec<int64_t>());
+  ASSERT_TRUE(std::equal(map.begin(), map.end(), loaded.begin(),
+                         loaded.end()));
+}
+
+TEST(serialization, modes) {
+  indexed_skip_map<int, int> indexed;
+  bidirectional_skip_map<int, int> bidirectional;
+  for (int i = 0; i < 1000; ++i) {
+    indexed.emplace(i, i);
+    bidirectional.emplace(i, i);
+  }
+
+  std::stringstream stream;
+  indexed.save(stream);
+  bidirectional.load(stream);
+  check_back_links(bidirectional);
+
+  stream.clear();
+  stream.str("");
+  bidirectional.save(stream);
+  indexed.load(stream);
+  check_indexes(indexed);
+}
+
+TEST(serialization, invalid_streams) {
+  skip_map<int, std::string> sm;
+  for (int i = 0; i < 100; ++i) {
+    sm.emplace(i, std::to_string(i));
+  }
+  std::stringstream stream;
+  sm.save(stream);
+  const std::string bytes = stream.str();
+
+  // Every failure leaves the map empty.
+  skip_map<int, std::string> loaded;
+  auto load = [&loaded](const std::string& input) {
+    loaded.emplace(-1, "previous");
+    std::istringstream in(input);
+    ASSERT_THROW(loaded.load(in), std::runtime_error);
+    ASSERT_TRUE(loaded.empty());
+    ASSERT_EQ(loaded.begin(), loaded.end());
+  };
+  load("");
+  load("not a skip_map stream at all");
+  load(bytes.substr(0, bytes.size() / 2));
+  load(bytes.substr(0, bytes.size() - sizeof(skip_map_stream::block_header)));
+
+  // Keys written out of order.
+  skip_map<int, std::string, std::greater<int>> reversed(sm.begin(), sm.end());
+  std::stringstream reversed_stream;
+  reversed.save(reversed_stream);
+  load(reversed_stream.str());
+
+  loaded.emplace(-1, "previous");
+  std::istringstream in(bytes);
+  loaded.load(in);
+  ASSERT_EQ(loaded, sm);
+}
+
 int main(int argc, char** argv) {
   std::string filter("*");
   ::testing::GTEST_FLAG(filter) = filter;
@@ -0,0 +1,776 @@
+#ifndef unrolled_skip_map_h
+#define unrolled_skip_map_h
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <ratio>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include "level_generator.h"
+#include "simd_search.h"
+
+/**
+ * Block of an unrolled_skip_map. A block holds up to BlockSize entries sorted
+ * by key, the keys in one array and the mapped values in another so that
+ * searching a block only touches the keys. Like skip_map_node the tower of
+ * links is placed right in front of the block in the same allocation:
+ *
+ *   [link h-1]...[link 1][link 0][height][size][keys...][values...]
+ *                                ^ this
+ *
+ * Allocations are made of whole cache lines and start on a cache line.
+ * Entries are constructed and destroyed one by one in the raw arrays.
+ */
+template <class Key, class T, size_t BlockSize>
+class unrolled_skip_map_block {
+ public:
+  static_assert(BlockSize > 1 && BlockSize <= 255,
+                "Block sizes are stored on a single byte");
+  static_assert(std::is_nothrow_move_constructible_v<Key> &&
+                    std::is_nothrow_move_constructible_v<T>,
+                "Entries are moved within and across blocks");
+
+  using link_type = unrolled_skip_map_block*;
+
+  static constexpr size_t cache_line = 64;
+
+  /**
+   * Unit of storage in which blocks are allocated. Allocators are rebound to
+   * this type and asked for lines_for(height) of them.
+   */
+  struct alignas(cache_line) line {
+    unsigned char bytes[cache_line];
+  };
+
+  /**
+   * Number of lines needed to hold a block of the given height.
+   */
+  static constexpr size_t lines_for(size_t height) {
+    return (height * sizeof(link_type) + sizeof(unrolled_skip_map_block) +
+            cache_line - 1) /
+           cache_line;
+  }
+
+  /**
+   * Constructs an empty block of the given height in storage, which has to be
+   * at least lines_for(height) lines long. All links are set to nullptr.
+   */
+  static unrolled_skip_map_block* create(void* storage, size_t height) {
+    static_assert(alignof(unrolled_skip_map_block) <= alignof(link_type),
+                  "Blocks are placed right after their tower");
+    auto* base = static_cast<unsigned char*>(storage);
+    auto* block = ::new (base + height * sizeof(link_type))
+        unrolled_skip_map_block(height);
+    std::uninitialized_fill_n(block->links_end() - height, height, nullptr);
+    return block;
+  }
+
+  /**
+   * Destroys the block and its entries and returns the storage it was created
+   * in.
+   */
+  static void* destroy(unrolled_skip_map_block* block) {
+    void* storage = block->storage();
+    block->clear();
+    block->~unrolled_skip_map_block();
+    return storage;
+  }
+
+  size_t height() const { return height_; }
+  size_t size() const { return size_; }
+  bool full() const { return size_ == BlockSize; }
+
+  void* storage() {
+    return reinterpret_cast<unsigned char*>(this) -
+           height_ * sizeof(link_type);
+  }
+
+  unrolled_skip_map_block* link_at(size_t i) const {
+    return *(links_end() - 1 - i);
+  }
+
+  void set_link(size_t i, unrolled_skip_map_block* link) {
+    *(links_end() - 1 - i) = link;
+  }
+
+  const Key& key(size_t i) const { return keys()[i]; }
+  T& value(size_t i) { return values()[i]; }
+  const T& value(size_t i) const { return values()[i]; }
+
+  /**
+   * Index of the first key not before key, size() if there is none. Integer
+   * keys in their natural order are searched with vector compares.
+   */
+  template <class Compare>
+  size_t lower_bound(const Key& key, const Compare& compare) const {
+    if constexpr (is_simd_searchable_v<Key, Compare>) {
+      return simd_lower_bound(keys(), size_, BlockSize, key);
+    } else {
+      return std::lower_bound(keys(), keys() + size_, key, compare) - keys();
+    }
+  }
+
+  /**
+   * Inserts an entry at pos, the following entries are shifted. The block
+   * must not be full.
+   */
+  template <class K, class... Args>
+  void emplace(size_t pos, K&& key, Args&&... args) {
+    // Construct at the end first, nothing has moved if it throws.
+    ::new (values() + size_) T(std::forward<Args>(args)...);
+    try {
+      ::new (keys() + size_) Key(std::forward<K>(key));
+    } catch (...) {
+      values()[size_].~T();
+      throw;
+    }
+    std::rotate(keys() + pos, keys() + size_, keys() + size_ + 1);
+    std::rotate(values() + pos, values() + size_, values() + size_ + 1);
+    ++size_;
+  }
+
+  /**
+   * Removes the entry at pos, the following entries are shifted.
+   */
+  void erase(size_t pos) {
+    std::move(keys() + pos + 1, keys() + size_, keys() + pos);
+    std::move(values() + pos + 1, values() + size_, values() + pos);
+    --size_;
+    keys()[size_].~Key();
+    values()[size_].~T();
+  }
+
+  /**
+   * Moves the entries of other, all after the ones of this block, to the end
+   * of this block. Both have to fit.
+   */
+  void append_from(unrolled_skip_map_block& other) { other.move_to(*this, 0); }
+
+  /**
+   * Moves the upper half of the entries to the empty block other.
+   */
+  void split_to(unrolled_skip_map_block& other) { move_to(other, size_ / 2); }
+
+  /**
+   * Copies the entries of other to the end of this block.
+   */
+  void append_copy(const unrolled_skip_map_block& other) {
+    for (size_t i = 0; i < other.size_; ++i) {
+      ::new (values() + size_) T(other.value(i));
+      try {
+        ::new (keys() + size_) Key(other.key(i));
+      } catch (...) {
+        values()[size_].~T();
+        throw;
+      }
+      ++size_;
+    }
+  }
+
+  void clear() {
+    std::destroy_n(keys(), size_);
+    std::destroy_n(values(), size_);
+    size_ = 0;
+  }
+
+ private:
+  explicit unrolled_skip_map_block(size_t height)
+      : height_(static_cast<std::uint8_t>(height)) {}
+
+  ~unrolled_skip_map_block() = default;
+
+  /**
+   * Moves the entries from first on to the end of other.
+   */
+  void move_to(unrolled_skip_map_block& other, size_t first) {
+    std::uninitialized_move(keys() + first, keys() + size_,
+                            other.keys() + other.size_);
+    std::uninitialized_move(values() + first, values() + size_,
+                            other.values() + other.size_);
+    std::destroy(keys() + first, keys() + size_);
+    std::destroy(values() + first, values() + size_);
+    other.size_ += size_ - first;
+    size_ = first;
+  }
+
+  Key* keys() { return std::launder(reinterpret_cast<Key*>(keys_)); }
+  const Key* keys() const {
+    return std::launder(reinterpret_cast<const Key*>(keys_));
+  }
+  T* values() { return std::launder(reinterpret_cast<T*>(values_)); }
+  const T* values() const {
+    return std::launder(reinterpret_cast<const T*>(values_));
+  }
+
+  link_type* links_end() const {
+    return reinterpret_cast<link_type*>(const_cast<unsigned char*>(
+        reinterpret_cast<const unsigned char*>(this)));
+  }
+
+  std::uint8_t height_;
+  std::uint8_t size_{0};
+  alignas(Key) unsigned char keys_[BlockSize * sizeof(Key)];
+  alignas(T) unsigned char values_[BlockSize * sizeof(T)];
+};
+
+/**
+ * Iterator over an unrolled_skip_map, a block and a position in it. Keys and
+ * values are not stored together so dereferencing gives a pair of references
+ * instead of a reference to a pair.
+ */
+template <class Key, class T, size_t BlockSize, bool is_const>
+class unrolled_skip_map_iterator {
+ public:
+  using block_type = unrolled_skip_map_block<Key, T, BlockSize>;
+  using iterator_category = std::forward_iterator_tag;
+  using difference_type = std::ptrdiff_t;
+  using value_type = std::pair<const Key, T>;
+  using reference = std::pair<const Key&, std::conditional_t<is_const,
+                                                             const T&,
+                                                             T&>>;
+
+  /**
+   * Lets it->first and it->second work on the pair of references.
+   */
+  struct pointer {
+    reference* operator->() { return &ref; }
+    reference ref;
+  };
+
+  unrolled_skip_map_iterator() = default;
+  unrolled_skip_map_iterator(block_type* block, size_t pos)
+      : block_(block), pos_(pos) {}
+  unrolled_skip_map_iterator(
+      const unrolled_skip_map_iterator<Key, T, BlockSize, false>& other)
+      : block_(other.block()), pos_(other.pos()) {}
+
+  reference operator*() const {
+    return {block_->key(pos_), block_->value(pos_)};
+  }
+  pointer operator->() const { return pointer{**this}; }
+
+  unrolled_skip_map_iterator& operator++() {
+    if (++pos_ == block_->size()) {
+      block_ = block_->link_at(0);
+      pos_ = 0;
+    }
+    return *this;
+  }
+
+  unrolled_skip_map_iterator operator++(int) {
+    auto tmp = *this;
+    ++*this;
+    return tmp;
+  }
+
+  bool operator==(const unrolled_skip_map_iterator& rhs) const {
+    return block_ == rhs.block_ && pos_ == rhs.pos_;
+  }
+  bool operator!=(const unrolled_skip_map_iterator& rhs) const {
+    return !(*this == rhs);
+  }
+
+  block_type* block() const { return block_; }
+  size_t pos() const { return pos_; }
+
+ private:
+  block_type* block_{nullptr};
+  size_t pos_{0};
+};
+
+/**
+ * unrolled_skip_map is a sorted associative container with unique keys built
+ * as an unrolled skip list. The bottom level is a list of blocks holding up
+ * to BlockSize sorted keys each and the towers index the blocks by their
+ * first key. Compared to skip_map, which has one node per element:
+ *
+ * - Scans read keys and values from contiguous arrays, one allocation every
+ *   BlockSize elements instead of one per element.
+ * - Searches hop between blocks, about BlockSize times fewer than between
+ *   nodes, then finish with a binary search in the block.
+ * - Links and allocation headers are shared by the elements of a block.
+ *
+ * Full blocks are split in halves. A block is merged with the next one when
+ * an erasure leaves them with at most BlockSize / 2 elements together.
+ * Elements move within and across blocks so insertions and erasures
+ * invalidate iterators.
+ *
+ * LevelGenerator draws the level of each new block, as in skip_map.
+ */
+template <class Key,
+          class T,
+          class Compare = std::less<Key>,
+          class Allocator = std::allocator<std::pair<const Key, T>>,
+          size_t BlockSize = 16,
+          size_t MaxLevel = 16,
+          class Probability = std::ratio<1, 4>,
+          class LevelGenerator =
+              xorshift_level_generator<MaxLevel, Probability>>
+class unrolled_skip_map {
+ public:
+  static_assert(MaxLevel > 0 && MaxLevel <= 255,
+                "Block heights are stored on a single byte");
+
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using size_type = std::size_t;
+  using key_compare = Compare;
+  using allocator_type = Allocator;
+  using level_generator_type = LevelGenerator;
+  using block_type = unrolled_skip_map_block<Key, T, BlockSize>;
+  using iterator = unrolled_skip_map_iterator<Key, T, BlockSize, false>;
+  using const_iterator = unrolled_skip_map_iterator<Key, T, BlockSize, true>;
+
+  unrolled_skip_map() : head_(allocate_block(MaxLevel)) {}
+
+  explicit unrolled_skip_map(const Allocator& allocator)
+      : allocator_(allocator), head_(allocate_block(MaxLevel)) {}
+
+  /**
+   * Empty container drawing block levels from levels, e.g. a generator with a
+   * fixed seed.
+   */
+  explicit unrolled_skip_map(const LevelGenerator& levels)
+      : head_(allocate_block(MaxLevel)), levels_(levels) {}
+
+  template <class InputIt>
+  unrolled_skip_map(InputIt first, InputIt last) : unrolled_skip_map() {
+    insert(first, last);
+  }
+
+  unrolled_skip_map(std::initializer_list<value_type> init)
+      : unrolled_skip_map(init.begin(), init.end()) {}
+
+  /**
+   * Copies the blocks one by one, the copy has the same structure.
+   */
+  unrolled_skip_map(const unrolled_skip_map& rhs)
+      : allocator_(std::allocator_traits<block_allocator_type>::
+                       select_on_container_copy_construction(rhs.allocator_)),
+        head_(allocate_block(MaxLevel)),
+        key_comparator_(rhs.key_comparator_),
+        levels_(rhs.levels_) {
+    level_nodes_t tail;
+    tail.fill(head_);
+    try {
+      for (auto block = rhs.head_->link_at(0); block;
+           block = block->link_at(0)) {
+        auto copy = allocate_block(block->height());
+        link_after(tail, copy);
+        copy->append_copy(*block);
+        size_ += copy->size();
+      }
+    } catch (...) {
+      release_blocks();
+      destroy_block(head_);
+      throw;
+    }
+  }
+
+  unrolled_skip_map(unrolled_skip_map&& rhs) noexcept
+      : allocator_(std::move(rhs.allocator_)),
+        head_(std::exchange(rhs.head_, nullptr)),
+        size_(std::exchange(rhs.size_, 0)),
+        max_level_(std::exchange(rhs.max_level_, 0)),
+        key_comparator_(std::move(rhs.key_comparator_)),
+        levels_(std::move(rhs.levels_)) {}
+
+  unrolled_skip_map& operator=(unrolled_skip_map rhs) {
+    swap(rhs);
+    return *this;
+  }
+
+  ~unrolled_skip_map() {
+    // A null head means the contents were moved out.
+    if (head_) {
+      release_blocks();
+      destroy_block(head_);
+    }
+  }
+
+  allocator_type get_allocator() const { return allocator_type(allocator_); }
+
+  iterator begin() { return iterator(head_->link_at(0), 0); }
+  const_iterator begin() const { return const_iterator(head_->link_at(0), 0); }
+  const_iterator cbegin() const { return begin(); }
+  iterator end() { return iterator(); }
+  const_iterator end() const { return const_iterator(); }
+  const_iterator cend() const { return end(); }
+
+  bool empty() const { return size_ == 0; }
+  size_type size() const { return size_; }
+
+  /**
+   * Number of blocks holding the elements.
+   */
+  size_type block_count() const {
+    size_type count = 0;
+    for (auto block = head_->link_at(0); block; block = block->link_at(0)) {
+      ++count;
+    }
+    return count;
+  }
+
+  void clear() {
+    release_blocks();
+    for (size_t level = 0; level < MaxLevel; ++level) {
+      head_->set_link(level, nullptr);
+    }
+    max_level_ = 0;
+    size_ = 0;
+  }
+
+  /**
+   * If there is no element with a key equivalent to key, inserts an element
+   * with the key and a mapped value constructed from args.
+   */
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(const key_type& key, Args&&... args) {
+    return try_emplace_key(key, std::forward<Args>(args)...);
+  }
+
+  /**
+   * rvalue overload of try_emplace(), the key is moved into the new element.
+   */
+  template <class... Args>
+  std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+    return try_emplace_key(std::move(key), std::forward<Args>(args)...);
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  std::pair<iterator, bool> insert(value_type&& value) {
+    return try_emplace(value.first, std::move(value.second));
+  }
+
+  template <class InputIt>
+  void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  T& operator[](const Key& key) { return (*try_emplace(key).first).second; }
+
+  T& at(const Key& key) {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("unrolled_skip_map::at");
+    }
+    return (*it).second;
+  }
+
+  const T& at(const Key& key) const {
+    auto it = find(key);
+    if (it == end()) {
+      throw std::out_of_range("unrolled_skip_map::at");
+    }
+    return (*it).second;
+  }
+
+  /**
+   * Removes the element with a key equivalent to key, if any. Returns the
+   * number of elements removed, 0 or 1.
+   */
+  size_type erase(const Key& key) {
+    auto preds = predecessors(key);
+    auto block = preds[0];
+    if (block == head_) {
+      return 0;
+    }
+    size_t pos = block->lower_bound(key, key_comparator_);
+    if (pos == block->size() || key_comparator_(key, block->key(pos))) {
+      return 0;
+    }
+
+    auto next = block->link_at(0);
+    if (block->size() == 1 && !next) {
+      // The last block becomes empty, it is removed with its element. Its
+      // predecessors are the ones of the key it holds.
+      preds = predecessors(key, false);
+      unlink_after(preds, block);
+      destroy_block(block);
+      --size_;
+      return 1;
+    }
+
+    block->erase(pos);
+    --size_;
+
+    // An empty block can't stay in the list, the next one is folded into it.
+    if (next && (block->size() == 0 ||
+                 block->size() + next->size() <= BlockSize / 2)) {
+      block->append_from(*next);
+      unlink_after(preds, block, next);
+      destroy_block(next);
+    }
+    return 1;
+  }
+
+  iterator find(const Key& key) {
+    auto it = const_this().find(key);
+    return iterator(it.block(), it.pos());
+  }
+
+  const_iterator find(const Key& key) const {
+    auto it = lower_bound(key);
+    if (it != end() && !key_comparator_(key, (*it).first)) {
+      return it;
+    }
+    return end();
+  }
+
+  bool contains(const Key& key) const { return find(key) != end(); }
+  size_type count(const Key& key) const { return contains(key) ? 1 : 0; }
+
+  iterator lower_bound(const Key& key) {
+    auto it = const_this().lower_bound(key);
+    return iterator(it.block(), it.pos());
+  }
+
+  /**
+   * Returns an iterator to the first element not before key.
+   */
+  const_iterator lower_bound(const Key& key) const {
+    block_type* block = head_;
+    for (size_t level = max_level_ + 1; level-- > 0;) {
+      advance(block, level, key, true);
+    }
+    if (block == head_) {
+      return begin();
+    }
+
+    size_t pos = block->lower_bound(key, key_comparator_);
+    if (pos == block->size()) {
+      return const_iterator(block->link_at(0), 0);
+    }
+    return const_iterator(block, pos);
+  }
+
+  void swap(unrolled_skip_map& other) {
+    std::swap(allocator_, other.allocator_);
+    std::swap(head_, other.head_);
+    std::swap(size_, other.size_);
+    std::swap(max_level_, other.max_level_);
+    std::swap(key_comparator_, other.key_comparator_);
+    std::swap(levels_, other.levels_);
+  }
+
+ private:
+  using level_nodes_t = std::array<block_type*, MaxLevel>;
+  using block_allocator_type = typename std::allocator_traits<
+      Allocator>::template rebind_alloc<typename block_type::line>;
+
+  const unrolled_skip_map& const_this() { return *this; }
+
+  /**
+   * Inserts an element with key and a mapped value constructed from args
+   * unless key is already there. Full blocks are split in halves.
+   */
+  template <class K, class... Args>
+  std::pair<iterator, bool> try_emplace_key(K&& key, Args&&... args) {
+    auto preds = predecessors(key);
+    auto block = preds[0];
+    size_t pos = 0;
+    if (block == head_) {
+      // Before every block, the key goes to the front of the first one.
+      block = head_->link_at(0);
+      if (!block) {
+        // Blocks are never empty once linked.
+        block = allocate_block(levels_() + 1);
+        try {
+          block->emplace(0, std::forward<K>(key), std::forward<Args>(args)...);
+        } catch (...) {
+          destroy_block(block);
+          throw;
+        }
+        link_after(preds, block);
+        ++size_;
+        return {iterator(block, 0), true};
+      }
+    } else {
+      pos = block->lower_bound(key, key_comparator_);
+      if (pos < block->size() && !key_comparator_(key, block->key(pos))) {
+        return {iterator(block, pos), false};
+      }
+    }
+
+    if (block->full()) {
+      auto upper = allocate_block(levels_() + 1);
+      link_after(preds, block, upper);
+      block->split_to(*upper);
+      if (pos > block->size()) {
+        pos -= block->size();
+        block = upper;
+      }
+    }
+
+    block->emplace(pos, std::forward<K>(key), std::forward<Args>(args)...);
+    ++size_;
+    return {iterator(block, pos), true};
+  }
+
+  /**
+   * Moves block forward on level as long as the next block starts before key,
+   * or at key when inclusive.
+   */
+  void advance(block_type*& block,
+               size_t level,
+               const Key& key,
+               bool inclusive) const {
+    for (auto next = block->link_at(level);
+         next && (inclusive ? !key_comparator_(key, next->key(0))
+                            : key_comparator_(next->key(0), key));
+         next = block->link_at(level)) {
+      block = next;
+    }
+  }
+
+  /**
+   * Returns the last block starting at or before key on each level, or
+   * strictly before key when not inclusive. head_ stands for no block.
+   */
+  level_nodes_t predecessors(const Key& key, bool inclusive = true) const {
+    level_nodes_t preds;
+    preds.fill(head_);
+
+    block_type* block = head_;
+    for (size_t level = max_level_ + 1; level-- > 0;) {
+      advance(block, level, key, inclusive);
+      preds[level] = block;
+    }
+    return preds;
+  }
+
+  /**
+   * Links block after the predecessors of its first key on every level of
+   * its tower. preds is left on block.
+   */
+  void link_after(level_nodes_t& preds, block_type* block) {
+    raise_max_level(block->height() - 1);
+    for (size_t level = 0; level < block->height(); ++level) {
+      block->set_link(level, preds[level]->link_at(level));
+      preds[level]->set_link(level, block);
+      preds[level] = block;
+    }
+  }
+
+  /**
+   * Links upper right after block, preds being the predecessors of a key held
+   * by block. Below the height of block the predecessor of upper is block.
+   */
+  void link_after(const level_nodes_t& preds,
+                  block_type* block,
+                  block_type* upper) {
+    raise_max_level(upper->height() - 1);
+    for (size_t level = 0; level < upper->height(); ++level) {
+      auto pred = level < block->height() ? block : preds[level];
+      upper->set_link(level, pred->link_at(level));
+      pred->set_link(level, upper);
+    }
+  }
+
+  /**
+   * Unlinks block, preds being its predecessors.
+   */
+  void unlink_after(const level_nodes_t& preds, block_type* block) {
+    for (size_t level = 0; level < block->height(); ++level) {
+      preds[level]->set_link(level, block->link_at(level));
+    }
+  }
+
+  /**
+   * Unlinks next, the block following block, preds being the predecessors of
+   * a key held by block.
+   */
+  void unlink_after(const level_nodes_t& preds,
+                    block_type* block,
+                    block_type* next) {
+    for (size_t level = 0; level < next->height(); ++level) {
+      auto pred = level < block->height() ? block : preds[level];
+      pred->set_link(level, next->link_at(level));
+    }
+  }
+
+  void raise_max_level(size_t level) {
+    max_level_ = std::max(max_level_, level);
+  }
+
+  block_type* allocate_block(size_t height) {
+    using traits = std::allocator_traits<block_allocator_type>;
+    return block_type::create(
+        traits::allocate(allocator_, block_type::lines_for(height)), height);
+  }
+
+  void destroy_block(block_type* block) {
+    using traits = std::allocator_traits<block_allocator_type>;
+    const size_t lines = block_type::lines_for(block->height());
+    traits::deallocate(
+        allocator_,
+        static_cast<typename block_type::line*>(block_type::destroy(block)),
+        lines);
+  }
+
+  /**
+   * Destroys every block but head_, whose links are left dangling.
+   */
+  void release_blocks() noexcept {
+    for (auto block = head_->link_at(0); block;) {
+      auto next = block->link_at(0);
+      destroy_block(block);
+      block = next;
+    }
+  }
+
+  block_allocator_type allocator_;
+
+  /**
+   * Empty block with a full tower starting every level.
+   */
+  block_type* head_;
+
+  size_type size_{0};
+  size_t max_level_{0};
+  key_compare key_comparator_;
+  LevelGenerator levels_;
+};
+
+template <class Key,
+          class T,
+          class Compare,
+          class Allocator,
+          size_t BlockSize,
+          size_t MaxLevel,
+          class Probability,
+          class Levels>
+void swap(unrolled_skip_map<Key,
+                            T,
+                            Compare,
+                            Allocator,
+                            BlockSize,
+                            MaxLevel,
+                            Probability,
+                            Levels>& lhs,
+          unrolled_skip_map<Key,
+                            T,
+                            Compare,
+                            Allocator,
+                            BlockSize,
+                            MaxLevel,
+                            Probability,
+                            Levels>& rhs) {
+  lhs.swap(rhs);
+}
+
+#endif /* unrolled_skip_map_h */
@@ -0,0 +1,577 @@
+#ifndef versioned_skip_map_h
+#define versioned_skip_map_h
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <ratio>
+#include <tuple>
+#include <utility>
+#include "atomic_skip_map_node.h"
+#include "epoch_domain.h"
+#include "level_generator.h"
+
+/**
+ * Node of a versioned_skip_map, stamped with the version that inserted it and
+ * the version that erased or overwrote it. The entry is never modified once
+ * the node is linked.
+ */
+template <class Key, class T>
+class versioned_skip_map_node
+    : public atomic_skip_map_node<versioned_skip_map_node<Key, T>,
+                                  versioned_skip_map_node<Key, T>*> {
+ public:
+  using version_type = std::uint64_t;
+
+  /**
+   * Death version of the nodes that were not erased.
+   */
+  static constexpr version_type alive =
+      std::numeric_limits<version_type>::max();
+
+  /**
+   * Checks if the element is part of the given version of the map.
+   */
+  bool visible_at(version_type version) const {
+    return born <= version && died.load(std::memory_order_acquire) > version;
+  }
+
+  std::pair<const Key, T> entry;
+  const version_type born;
+  std::atomic<version_type> died{alive};
+
+ private:
+  friend class atomic_skip_map_node<versioned_skip_map_node,
+                                    versioned_skip_map_node*>;
+
+  template <class... Args>
+  explicit versioned_skip_map_node(size_t height,
+                                   version_type born,
+                                   Args&&... arguments)
+      : entry(std::forward<Args>(arguments)...),
+        born(born),
+        height_(static_cast<std::uint8_t>(height)) {}
+
+  std::uint8_t height_;
+};
+
+/**
+ * versioned_skip_map is a sorted associative container with unique keys whose
+ * past versions stay readable while it is modified. Every modification makes
+ * a new version, snapshot() pins the current one in O(1) and returns an
+ * immutable view of it that can be iterated from any thread.
+ *
+ * Versions share their nodes, which are stamped instead of copied:
+ *
+ * - Inserting links a node born in the new version.
+ * - Erasing sets the version the node died in and leaves it linked.
+ * - Assigning does both. The new node is linked in front of the old one, so
+ *   the versions of a key are neighbours, newest first.
+ *
+ * Readers of version v skip the nodes that are not alive in v. A dead node is
+ * unlinked once the snapshots older than its death are gone, and once the
+ * lookups that read the latest version before its death are done. Lookups
+ * pin epoch_domain before reading the version, so the node waits for the
+ * epoch to move twice past the one of its death. It is then freed through
+ * epoch_domain, readers may still be walking over it.
+ *
+ * Writers are serialized by a mutex, readers never wait. Lookups on the map
+ * read the latest version and return copies, like lazy_skip_map. Snapshots
+ * have to be destroyed before their map.
+ */
+template <class Key,
+          class T,
+          class Compare = std::less<Key>,
+          size_t MaxLevel = 16,
+          class Probability = std::ratio<1, 4>>
+class versioned_skip_map {
+ public:
+  static_assert(MaxLevel > 0 && MaxLevel <= 255,
+                "Node heights are stored on a single byte");
+
+  using key_type = Key;
+  using mapped_type = T;
+  using value_type = std::pair<const Key, T>;
+  using size_type = std::size_t;
+  using key_compare = Compare;
+  using node_type = versioned_skip_map_node<Key, T>;
+  using version_type = typename node_type::version_type;
+
+  /**
+   * Immutable view of the map as it was when the snapshot was taken. The
+   * elements it sees are kept until the last copy of it is destroyed. A moved
+   * from snapshot can only be assigned to or destroyed.
+   */
+  class snapshot_type {
+   public:
+    /**
+     * Forward iterator over the elements of a snapshot. It stays valid as
+     * long as the snapshot exists, whatever the writers do.
+     */
+    class const_iterator {
+     public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = versioned_skip_map::value_type;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const value_type*;
+      using reference = const value_type&;
+
+      const_iterator() = default;
+
+      reference operator*() const { return node_->entry; }
+      pointer operator->() const { return &node_->entry; }
+
+      const_iterator& operator++() {
+        epoch_domain::guard guard;
+        node_ = next_visible(node_->link(0).load(), version_);
+        return *this;
+      }
+
+      const_iterator operator++(int) {
+        const_iterator tmp(*this);
+        operator++();
+        return tmp;
+      }
+
+      bool operator==(const const_iterator& other) const {
+        return node_ == other.node_;
+      }
+      bool operator!=(const const_iterator& other) const {
+        return node_ != other.node_;
+      }
+
+     private:
+      friend class snapshot_type;
+
+      const_iterator(const node_type* node, version_type version)
+          : node_(node), version_(version) {}
+
+      const node_type* node_ = nullptr;
+      version_type version_ = 0;
+    };
+
+    using iterator = const_iterator;
+
+    snapshot_type(const snapshot_type& other)
+        : map_(other.map_), version_(other.version_), size_(other.size_) {
+      map_->acquire(version_);
+    }
+
+    snapshot_type(snapshot_type&& other) noexcept
+        : map_(other.map_), version_(other.version_), size_(other.size_) {
+      other.map_ = nullptr;
+    }
+
+    snapshot_type& operator=(snapshot_type other) noexcept {
+      std::swap(map_, other.map_);
+      std::swap(version_, other.version_);
+      std::swap(size_, other.size_);
+      return *this;
+    }
+
+    ~snapshot_type() {
+      if (map_) {
+        map_->release(version_);
+      }
+    }
+
+    const_iterator begin() const {
+      epoch_domain::guard guard;
+      return {next_visible(map_->head_->link(0).load(), version_), version_};
+    }
+    const_iterator end() const { return {nullptr, version_}; }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    /**
+     * Returns the element with a key equivalent to key, or end().
+     */
+    const_iterator find(const key_type& key) const {
+      epoch_domain::guard guard;
+      return {map_->find_node(key, version_), version_};
+    }
+
+    /**
+     * Returns the first element that is not less than key, or end().
+     */
+    const_iterator lower_bound(const key_type& key) const {
+      epoch_domain::guard guard;
+      return {map_->search(key, version_), version_};
+    }
+
+    bool contains(const key_type& key) const { return find(key) != end(); }
+
+    size_type size() const { return size_; }
+
+    bool empty() const { return size_ == 0; }
+
+    /**
+     * Version of the map seen by the snapshot.
+     */
+    version_type version() const { return version_; }
+
+   private:
+    friend class versioned_skip_map;
+
+    snapshot_type(versioned_skip_map* map, version_type version, size_type size)
+        : map_(map), version_(version), size_(size) {}
+
+    versioned_skip_map* map_;
+    version_type version_;
+    size_type size_;
+  };
+
+  versioned_skip_map() : head_(node_type::create(MaxLevel, 0)) {}
+
+  versioned_skip_map(const versioned_skip_map&) = delete;
+  versioned_skip_map& operator=(const versioned_skip_map&) = delete;
+
+  /**
+   * No other thread may be using the container and no snapshot of it may be
+   * left. Nodes that were already unlinked are owned by the epoch domain.
+   */
+  ~versioned_skip_map() {
+    for (auto node = head_; node;) {
+      auto next = node->link(0).load();
+      node_type::destroy(node);
+      node = next;
+    }
+  }
+
+  /**
+   * Inserts value if there is no element with an equivalent key. Returns
+   * whether the insertion took place.
+   */
+  bool insert(const value_type& value) {
+    return try_emplace(value.first, value.second);
+  }
+
+  /**
+   * If there is no element with a key equivalent to key, inserts an element
+   * with the key and a mapped value constructed from args. Returns whether the
+   * insertion took place.
+   */
+  template <class... Args>
+  bool try_emplace(const key_type& key, Args&&... args) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    level_nodes_t preds;
+    if (find_alive(key, preds)) {
+      return false;
+    }
+    link_new_node(preds, key, std::forward<Args>(args)...);
+    size_.fetch_add(1, std::memory_order_relaxed);
+    publish();
+    return true;
+  }
+
+  /**
+   * Inserts an element with key and mapped value obj, or replaces the one
+   * with an equivalent key in the next version. Snapshots taken before keep
+   * seeing the previous value. Returns whether an insertion took place.
+   */
+  template <class M>
+  bool insert_or_assign(const key_type& key, M&& obj) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    level_nodes_t preds;
+    auto old = find_alive(key, preds);
+    link_new_node(preds, key, std::forward<M>(obj));
+    if (old) {
+      kill(old);
+    } else {
+      size_.fetch_add(1, std::memory_order_relaxed);
+    }
+    publish();
+    collect();
+    return !old;
+  }
+
+  /**
+   * Removes the element with a key equivalent to key from the next version.
+   * Returns whether this call removed it.
+   */
+  bool erase(const key_type& key) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    level_nodes_t preds;
+    auto victim = find_alive(key, preds);
+    if (!victim) {
+      return false;
+    }
+    kill(victim);
+    size_.fetch_sub(1, std::memory_order_relaxed);
+    publish();
+    collect();
+    return true;
+  }
+
+  /**
+   * Checks if there is an element with a key equivalent to key.
+   */
+  bool contains(const key_type& key) const {
+    epoch_domain::guard guard;
+    return find_node(key, version()) != nullptr;
+  }
+
+  /**
+   * Returns a copy of the mapped value of the element with a key equivalent
+   * to key, if any.
+   */
+  std::optional<T> find(const key_type& key) const {
+    epoch_domain::guard guard;
+    if (auto node = find_node(key, version())) {
+      return node->entry.second;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Returns a copy of the first element that is not less than key, if any.
+   */
+  std::optional<value_type> lower_bound(const key_type& key) const {
+    epoch_domain::guard guard;
+    if (auto node = search(key, version())) {
+      return node->entry;
+    }
+    return std::nullopt;
+  }
+
+  /**
+   * Calls f on every element in order. Elements inserted or erased during the
+   * walk may or may not be seen, take a snapshot for a consistent walk.
+   */
+  template <class F>
+  void for_each(F&& f) const {
+    epoch_domain::guard guard;
+    const version_type current = version();
+    for (auto node = next_visible(head_->link(0).load(), current); node;
+         node = next_visible(node->link(0).load(), current)) {
+      f(static_cast<const value_type&>(node->entry));
+    }
+  }
+
+  /**
+   * Returns a view of the latest version, which is kept until the view is
+   * destroyed.
+   */
+  snapshot_type snapshot() {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    const version_type current = version_.load(std::memory_order_relaxed);
+    ++snapshots_[current];
+    return {this, current, size_.load(std::memory_order_relaxed)};
+  }
+
+  /**
+   * Latest version of the map, each modification adds one.
+   */
+  version_type version() const { return version_.load(); }
+
+  /**
+   * Number of elements in the latest version.
+   */
+  size_type size() const { return size_.load(std::memory_order_relaxed); }
+
+  bool empty() const { return size() == 0; }
+
+  /**
+   * Number of erased or overwritten elements kept for the snapshots.
+   */
+  size_type stale_count() const {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    return dead_.size();
+  }
+
+ private:
+  using level_nodes_t = std::array<node_type*, MaxLevel>;
+
+  /**
+   * Node that died, with the epoch when its death was published.
+   */
+  struct dead_node {
+    node_type* node;
+    std::uint64_t epoch;
+  };
+
+  static constexpr std::uint64_t unpublished =
+      std::numeric_limits<std::uint64_t>::max();
+
+  static const node_type* next_visible(const node_type* node,
+                                       version_type version) {
+    while (node && !node->visible_at(version)) {
+      node = node->link(0).load();
+    }
+    return node;
+  }
+
+  /**
+   * Returns the first node of version not before key.
+   */
+  const node_type* search(const Key& key, version_type version) const {
+    const node_type* pred = head_;
+    const node_type* curr = nullptr;
+    for (size_t level = MaxLevel; level-- > 0;) {
+      curr = pred->link(level).load();
+      while (curr && key_comparator_(curr->entry.first, key)) {
+        pred = curr;
+        curr = curr->link(level).load();
+      }
+    }
+    return next_visible(curr, version);
+  }
+
+  const node_type* find_node(const Key& key, version_type version) const {
+    auto node = search(key, version);
+    return node && !key_comparator_(key, node->entry.first) ? node : nullptr;
+  }
+
+  /**
+   * Fills preds with the last node before key on every level and returns the
+   * node of key alive in the latest version, if any. Only the newest node of
+   * a key can be alive. Writer only.
+   */
+  node_type* find_alive(const Key& key, level_nodes_t& preds) const {
+    node_type* pred = head_;
+    for (size_t level = MaxLevel; level-- > 0;) {
+      auto curr = pred->link(level).load();
+      while (curr && key_comparator_(curr->entry.first, key)) {
+        pred = curr;
+        curr = curr->link(level).load();
+      }
+      preds[level] = pred;
+    }
+    auto newest = preds[0]->link(0).load();
+    if (newest && !key_comparator_(key, newest->entry.first) &&
+        newest->died.load(std::memory_order_relaxed) == node_type::alive) {
+      return newest;
+    }
+    return nullptr;
+  }
+
+  /**
+   * Links a node born in the next version after preds, in front of the older
+   * nodes of the same key. Writer only.
+   */
+  template <class... Args>
+  void link_new_node(level_nodes_t& preds, const Key& key, Args&&... args) {
+    const size_t height = levels_() + 1;
+    auto node = node_type::create(
+        height, version_.load(std::memory_order_relaxed) + 1,
+        std::piecewise_construct, std::forward_as_tuple(key),
+        std::forward_as_tuple(std::forward<Args>(args)...));
+    for (size_t level = 0; level < height; ++level) {
+      node->link(level).store(preds[level]->link(level).load(),
+                              std::memory_order_relaxed);
+    }
+    for (size_t level = 0; level < height; ++level) {
+      preds[level]->link(level).store(node);
+    }
+  }
+
+  /**
+   * Ends the life of node in the next version. Writer only.
+   */
+  void kill(node_type* node) {
+    node->died.store(version_.load(std::memory_order_relaxed) + 1,
+                     std::memory_order_release);
+    dead_.push_back({node, unpublished});
+  }
+
+  /**
+   * Makes the next version the latest one, readers starting after this see
+   * the modification as a whole. A lookup that read an older version pinned
+   * the epoch before, so at most the one read after the store.
+   */
+  void publish() {
+    version_.store(version_.load(std::memory_order_relaxed) + 1);
+    const std::uint64_t epoch = epoch_domain::instance().epoch();
+    for (auto it = dead_.rbegin();
+         it != dead_.rend() && it->epoch == unpublished; ++it) {
+      it->epoch = epoch;
+    }
+  }
+
+  void acquire(version_type version) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    ++snapshots_[version];
+  }
+
+  void release(version_type version) {
+    std::lock_guard<std::mutex> lock(writer_mutex_);
+    auto it = snapshots_.find(version);
+    if (--it->second == 0) {
+      snapshots_.erase(it);
+    }
+    collect();
+  }
+
+  /**
+   * Unlinks the dead nodes that neither a snapshot nor a lookup of the latest
+   * version can see anymore. Nodes die in version and epoch order, so the
+   * oldest deaths are checked first. Tries to move the epoch forward twice at
+   * most when it holds nodes back. Writer only.
+   */
+  void collect() {
+    const version_type horizon =
+        snapshots_.empty() ? version_.load(std::memory_order_relaxed)
+                           : snapshots_.begin()->first;
+    auto& domain = epoch_domain::instance();
+    for (int advances = 0; !dead_.empty();) {
+      const auto& front = dead_.front();
+      if (front.node->died.load(std::memory_order_relaxed) > horizon) {
+        break;
+      }
+      if (domain.epoch() < front.epoch + 2) {
+        if (advances++ == 2) {
+          break;
+        }
+        domain.collect();
+        continue;
+      }
+      unlink(front.node);
+      dead_.pop_front();
+    }
+  }
+
+  /**
+   * Removes node from every level and retires it. Newer nodes of the same key
+   * can come first. Writer only.
+   */
+  void unlink(node_type* node) {
+    node_type* pred = head_;
+    for (size_t level = MaxLevel; level-- > 0;) {
+      auto curr = pred->link(level).load();
+      while (curr && key_comparator_(curr->entry.first, node->entry.first)) {
+        pred = curr;
+        curr = curr->link(level).load();
+      }
+      if (level < node->height()) {
+        while (curr != node) {
+          pred = curr;
+          curr = curr->link(level).load();
+        }
+        pred->link(level).store(node->link(level).load());
+      }
+    }
+    epoch_domain::instance().retire(node, &node_type::destroy);
+  }
+
+  node_type* head_;
+  std::atomic<version_type> version_{0};
+  std::atomic<size_type> size_{0};
+  key_compare key_comparator_;
+
+  // Writer state.
+  mutable std::mutex writer_mutex_;
+  xorshift_level_generator<MaxLevel, Probability> levels_;
+  std::map<version_type, size_type> snapshots_;
+  std::deque<dead_node> dead_;
+};
+
+#endif /* versioned_skip_map_h */